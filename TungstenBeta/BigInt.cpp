@@ -0,0 +1,334 @@
+#include "BigInt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+BigInt::BigInt(long long value){
+    negative_ = value < 0;
+    // Negating through unsigned also handles the most negative value
+    uint64_t magnitude = negative_ ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    while (magnitude != 0){
+        limbs_.push_back(static_cast<uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+void BigInt::trim(){
+    while (!limbs_.empty() && limbs_.back() == 0){
+        limbs_.pop_back();
+    }
+    if (limbs_.empty()){
+        negative_ = false;
+    }
+}
+
+bool BigInt::fits_int64() const{
+    if (limbs_.size() > 2){
+        return false;
+    }
+    uint64_t magnitude = 0;
+    for (size_t i = limbs_.size(); i-- > 0;){
+        magnitude = (magnitude << 32) | limbs_[i];
+    }
+    return negative_ ? magnitude <= (uint64_t(1) << 63) : magnitude < (uint64_t(1) << 63);
+}
+
+long long BigInt::to_int64() const{
+    uint64_t magnitude = 0;
+    for (size_t i = limbs_.size(); i-- > 0;){
+        magnitude = (magnitude << 32) | limbs_[i];
+    }
+    return negative_ ? static_cast<long long>(0 - magnitude) : static_cast<long long>(magnitude);
+}
+
+double BigInt::to_double(int& exponent) const{
+    if (limbs_.empty()){
+        exponent = 0;
+        return 0;
+    }
+    // The top three limbs carry more than the 53 bits a double can hold
+    double value = 0;
+    size_t top = limbs_.size();
+    size_t used = std::min<size_t>(3, top);
+    for (size_t i = 0; i < used; ++i){
+        value = value * 4294967296.0 + limbs_[top - 1 - i];
+    }
+    int shift;
+    double mantissa = std::frexp(value, &shift);
+    exponent = shift + static_cast<int>(32 * (top - used));
+    return negative_ ? -mantissa : mantissa;
+}
+
+std::string BigInt::to_string() const{
+    if (limbs_.empty()){
+        return "0";
+    }
+    std::string digits;
+    Limbs current = limbs_;
+    while (!current.empty()){
+        // Divide by 10^9 and emit the nine-digit remainder
+        uint64_t remainder = 0;
+        for (size_t i = current.size(); i-- > 0;){
+            uint64_t part = (remainder << 32) | current[i];
+            current[i] = static_cast<uint32_t>(part / 1000000000);
+            remainder = part % 1000000000;
+        }
+        while (!current.empty() && current.back() == 0){
+            current.pop_back();
+        }
+        for (int k = 0; k < 9 && (!current.empty() || remainder != 0); ++k){
+            digits.push_back(static_cast<char>('0' + remainder % 10));
+            remainder /= 10;
+        }
+    }
+    if (negative_){
+        digits.push_back('-');
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+BigInt BigInt::from_string(std::string_view text){
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative){
+        text.remove_prefix(1);
+    }
+    if (text.empty()){
+        throw std::invalid_argument("BigInt: no digits");
+    }
+    BigInt value;
+    // Nine digits at a time, so every step is one multiply-add of limbs
+    size_t chunk = text.size() % 9 == 0 ? 9 : text.size() % 9;
+    for (size_t start = 0; start < text.size(); start += chunk, chunk = 9){
+        long long part = 0;
+        long long scale = 1;
+        for (char digit : text.substr(start, chunk)){
+            if (digit < '0' || digit > '9'){
+                throw std::invalid_argument("BigInt: invalid digit");
+            }
+            part = part * 10 + (digit - '0');
+            scale *= 10;
+        }
+        value = value * BigInt(scale) + BigInt(part);
+    }
+    return negative ? -value : value;
+}
+
+int BigInt::compare_magnitude(const Limbs& a, const Limbs& b){
+    if (a.size() != b.size()){
+        return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0;){
+        if (a[i] != b[i]){
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+BigInt::Limbs BigInt::add_magnitude(const Limbs& a, const Limbs& b){
+    const Limbs& longer = a.size() >= b.size() ? a : b;
+    const Limbs& shorter = a.size() >= b.size() ? b : a;
+    Limbs result(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i){
+        uint64_t sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        result[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    result[longer.size()] = static_cast<uint32_t>(carry);
+    return result;
+}
+
+BigInt::Limbs BigInt::subtract_magnitude(const Limbs& a, const Limbs& b){
+    Limbs result(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i){
+        int64_t difference = static_cast<int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+        borrow = difference < 0;
+        result[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+    return result;
+}
+
+BigInt::Limbs BigInt::multiply_magnitude(const Limbs& a, const Limbs& b){
+    Limbs result(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); ++i){
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); ++j){
+            uint64_t product = static_cast<uint64_t>(a[i]) * b[j] + result[i + j] + carry;
+            result[i + j] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        result[i + b.size()] = static_cast<uint32_t>(carry);
+    }
+    return result;
+}
+
+void BigInt::divide_magnitude(const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder){
+    if (compare_magnitude(a, b) < 0){
+        quotient.clear();
+        remainder = a;
+        return;
+    }
+
+    const size_t n = b.size();
+    if (n == 1){
+        quotient.assign(a.size(), 0);
+        uint64_t rest = 0;
+        for (size_t i = a.size(); i-- > 0;){
+            uint64_t part = (rest << 32) | a[i];
+            quotient[i] = static_cast<uint32_t>(part / b[0]);
+            rest = part % b[0];
+        }
+        remainder.assign(1, static_cast<uint32_t>(rest));
+        return;
+    }
+
+    // Knuth's algorithm D: normalize so the top divisor limb has its high
+    // bit set, then estimate every quotient limb from the top two limbs.
+    const size_t m = a.size() - n;
+    int shift = __builtin_clz(b.back());
+    Limbs v(n);
+    Limbs u(a.size() + 1);
+    for (size_t i = n; i-- > 0;){
+        v[i] = (b[i] << shift) | (shift && i > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(b[i - 1]) >> (32 - shift)) : 0);
+    }
+    u[a.size()] = shift ? static_cast<uint32_t>(static_cast<uint64_t>(a.back()) >> (32 - shift)) : 0;
+    for (size_t i = a.size(); i-- > 0;){
+        u[i] = (a[i] << shift) | (shift && i > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(a[i - 1]) >> (32 - shift)) : 0);
+    }
+
+    const uint64_t BASE = uint64_t(1) << 32;
+    quotient.assign(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0;){
+        uint64_t numerator = (static_cast<uint64_t>(u[j + n]) << 32) | u[j + n - 1];
+        uint64_t qhat = numerator / v[n - 1];
+        uint64_t rhat = numerator % v[n - 1];
+        while (qhat >= BASE || qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2])){
+            --qhat;
+            rhat += v[n - 1];
+            if (rhat >= BASE){
+                break;
+            }
+        }
+
+        int64_t borrow = 0;
+        for (size_t i = 0; i < n; ++i){
+            uint64_t product = qhat * v[i];
+            int64_t t = static_cast<int64_t>(u[i + j]) - borrow - static_cast<int64_t>(product & 0xffffffffULL);
+            u[i + j] = static_cast<uint32_t>(t);
+            borrow = static_cast<int64_t>(product >> 32) - (t >> 32);
+        }
+        int64_t t = static_cast<int64_t>(u[j + n]) - borrow;
+        u[j + n] = static_cast<uint32_t>(t);
+
+        if (t < 0){
+            // The estimate was one too large: add the divisor back
+            --qhat;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i){
+                uint64_t sum = static_cast<uint64_t>(u[i + j]) + v[i] + carry;
+                u[i + j] = static_cast<uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            u[j + n] = static_cast<uint32_t>(u[j + n] + carry);
+        }
+        quotient[j] = static_cast<uint32_t>(qhat);
+    }
+
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; ++i){
+        remainder[i] = (u[i] >> shift) | (shift ? static_cast<uint32_t>(static_cast<uint64_t>(u[i + 1]) << (32 - shift)) : 0);
+    }
+}
+
+BigInt BigInt::operator-() const{
+    BigInt result = *this;
+    if (!result.limbs_.empty()){
+        result.negative_ = !negative_;
+    }
+    return result;
+}
+
+BigInt BigInt::operator+(const BigInt& other) const{
+    BigInt result;
+    if (negative_ == other.negative_){
+        result.limbs_ = add_magnitude(limbs_, other.limbs_);
+        result.negative_ = negative_;
+    }
+    else if (compare_magnitude(limbs_, other.limbs_) >= 0){
+        result.limbs_ = subtract_magnitude(limbs_, other.limbs_);
+        result.negative_ = negative_;
+    }
+    else{
+        result.limbs_ = subtract_magnitude(other.limbs_, limbs_);
+        result.negative_ = other.negative_;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::operator-(const BigInt& other) const{
+    return *this + (-other);
+}
+
+BigInt BigInt::operator*(const BigInt& other) const{
+    BigInt result;
+    if (limbs_.empty() || other.limbs_.empty()){
+        return result;
+    }
+    result.limbs_ = multiply_magnitude(limbs_, other.limbs_);
+    result.negative_ = negative_ != other.negative_;
+    result.trim();
+    return result;
+}
+
+void BigInt::divmod(const BigInt& dividend, const BigInt& divisor, BigInt& quotient, BigInt& remainder){
+    if (divisor.is_zero()){
+        throw std::domain_error("BigInt: division by zero");
+    }
+    Limbs q;
+    Limbs r;
+    divide_magnitude(dividend.limbs_, divisor.limbs_, q, r);
+    quotient.limbs_ = std::move(q);
+    quotient.negative_ = dividend.negative_ != divisor.negative_;
+    quotient.trim();
+    remainder.limbs_ = std::move(r);
+    remainder.negative_ = dividend.negative_;
+    remainder.trim();
+}
+
+BigInt BigInt::operator/(const BigInt& other) const{
+    BigInt quotient;
+    BigInt remainder;
+    divmod(*this, other, quotient, remainder);
+    return quotient;
+}
+
+BigInt BigInt::operator%(const BigInt& other) const{
+    BigInt quotient;
+    BigInt remainder;
+    divmod(*this, other, quotient, remainder);
+    return remainder;
+}
+
+bool BigInt::operator<(const BigInt& other) const{
+    if (negative_ != other.negative_){
+        return negative_;
+    }
+    int order = compare_magnitude(limbs_, other.limbs_);
+    return negative_ ? order > 0 : order < 0;
+}
+
+BigInt BigInt::gcd(BigInt a, BigInt b){
+    a.negative_ = false;
+    b.negative_ = false;
+    while (!b.is_zero()){
+        BigInt rest = a % b;
+        a = std::move(b);
+        b = std::move(rest);
+    }
+    return a;
+}
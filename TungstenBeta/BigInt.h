@@ -0,0 +1,57 @@
+#ifndef BIG_INT_H
+#define BIG_INT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arbitrary-precision signed integer: sign and magnitude in 32-bit limbs,
+// least significant first. Only Rational uses it, once a value no longer
+// fits into 64 bits.
+class BigInt{
+public:
+    BigInt(long long value = 0);
+
+    bool is_zero() const { return limbs_.empty(); }
+    bool is_negative() const { return negative_; }
+    bool fits_int64() const;
+    long long to_int64() const;
+    // value = mantissa * 2^exponent with |mantissa| in [0.5, 1), so huge
+    // values can still be divided as doubles
+    double to_double(int& exponent) const;
+    std::string to_string() const;
+    // Decimal digits with an optional leading '-', as written by to_string()
+    static BigInt from_string(std::string_view text);
+
+    BigInt operator-() const;
+    BigInt operator+(const BigInt& other) const;
+    BigInt operator-(const BigInt& other) const;
+    BigInt operator*(const BigInt& other) const;
+    // Truncating division, like the built-in operators
+    BigInt operator/(const BigInt& other) const;
+    BigInt operator%(const BigInt& other) const;
+
+    bool operator==(const BigInt& other) const { return negative_ == other.negative_ && limbs_ == other.limbs_; }
+    bool operator!=(const BigInt& other) const { return !(*this == other); }
+    bool operator<(const BigInt& other) const;
+
+    static BigInt gcd(BigInt a, BigInt b);
+    static void divmod(const BigInt& dividend, const BigInt& divisor, BigInt& quotient, BigInt& remainder);
+
+private:
+    typedef std::vector<uint32_t> Limbs;
+
+    bool negative_ = false;
+    Limbs limbs_;
+
+    void trim();
+    static int compare_magnitude(const Limbs& a, const Limbs& b);
+    static Limbs add_magnitude(const Limbs& a, const Limbs& b);
+    // Requires |a| >= |b|
+    static Limbs subtract_magnitude(const Limbs& a, const Limbs& b);
+    static Limbs multiply_magnitude(const Limbs& a, const Limbs& b);
+    static void divide_magnitude(const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder);
+};
+
+#endif // BIG_INT_H
@@ -0,0 +1,388 @@
+#include "CompiledExpression.h"
+#include "ExpressionVisitor.h"
+#include "VectorMath.h"
+
+namespace{
+    inline double apply(const CompiledExpression::Instruction& ins, double a, double b){
+        using OpCode = CompiledExpression::OpCode;
+        switch (ins.op){
+            case OpCode::Add: return a + b;
+            case OpCode::Mul: return a * b;
+            case OpCode::Div: return a / b;
+            case OpCode::Square: return a * a;
+            case OpCode::Pow: return std::pow(a, b);
+            case OpCode::PowConst: return std::pow(a, ins.value);
+            case OpCode::ExpConst: return std::exp(a * ins.value);
+            case OpCode::Exp: return std::exp(b * std::log(a));
+            case OpCode::LogConst: return std::log(a) * ins.value;
+            case OpCode::Log: return std::log(b) / std::log(a);
+            case OpCode::Sin: return std::sin(a);
+            case OpCode::Cos: return std::cos(a);
+            case OpCode::Tan: return std::tan(a);
+            case OpCode::Cot: return 1 / std::tan(a);
+            default: return ins.value;
+        }
+    }
+}
+
+CompiledExpression::CompiledExpression(const Expression* expr){
+    std::unordered_map<const Expression*, int> emitted;
+    remove_dead_code(emit(expr, emitted));
+}
+
+int CompiledExpression::slot(const std::string& name) const{
+    auto it = std::find(variables_.begin(), variables_.end(), name);
+    return it == variables_.end() ? -1 : static_cast<int>(it - variables_.begin());
+}
+
+int CompiledExpression::variable_slot(const std::string& name){
+    int index = slot(name);
+    if (index < 0){
+        variables_.push_back(name);
+        context_slots_.push_back(EvalContext::slot_of(name));
+        index = static_cast<int>(variables_.size()) - 1;
+    }
+    return index;
+}
+
+int CompiledExpression::push(OpCode op, int lhs, int rhs, double value){
+    Instruction ins{op, lhs, rhs, value};
+    // Fold instructions whose operands are already known
+    bool constant = op != OpCode::Var && op != OpCode::Const
+        && (lhs < 0 || tape_[lhs].op == OpCode::Const)
+        && (rhs < 0 || tape_[rhs].op == OpCode::Const);
+    if (constant){
+        double a = lhs < 0 ? 0 : tape_[lhs].value;
+        double b = rhs < 0 ? 0 : tape_[rhs].value;
+        ins = Instruction{OpCode::Const, -1, -1, apply(ins, a, b)};
+    }
+    tape_.push_back(ins);
+    return static_cast<int>(tape_.size()) - 1;
+}
+
+int CompiledExpression::emit(const Expression* expr, std::unordered_map<const Expression*, int>& emitted){
+    auto it = emitted.find(expr);
+    if (it != emitted.end()){
+        return it->second;
+    }
+
+    int result = -1;
+    switch (expr->kind()){
+        case ExprKind::Constant:
+            result = push(OpCode::Const, -1, -1, expr->calculate());
+            break;
+        case ExprKind::Variable:
+            result = push(OpCode::Var, variable_slot(static_cast<const Variable*>(expr)->get_name()));
+            break;
+        case ExprKind::Sum:
+        case ExprKind::Product:{
+            OpCode op = expr->kind() == ExprKind::Sum ? OpCode::Add : OpCode::Mul;
+            for (const Expression* child : children(expr)){
+                int operand = emit(child, emitted);
+                result = result < 0 ? operand : push(op, result, operand);
+            }
+            if (result < 0){
+                result = push(OpCode::Const, -1, -1, op == OpCode::Add ? 0 : 1);
+            }
+            break;
+        }
+        case ExprKind::Fraction:{
+            const operators::Fraction* fraction = static_cast<const operators::Fraction*>(expr);
+            int dividend = emit(fraction->get_dividend(), emitted);
+            result = push(OpCode::Div, dividend, emit(fraction->get_divisor(), emitted));
+            break;
+        }
+        case ExprKind::Power:{
+            const ElementaryFunctions::Power* power = static_cast<const ElementaryFunctions::Power*>(expr);
+            int base = emit(power->get_base(), emitted);
+            int exponent = emit(power->get_power(), emitted);
+            if (tape_[exponent].op == OpCode::Const && tape_[base].op != OpCode::Const){
+                double p = tape_[exponent].value;
+                if (p == 1){
+                    result = base;
+                }
+                else if (p == 2){
+                    result = push(OpCode::Square, base);
+                }
+                else{
+                    result = push(OpCode::PowConst, base, -1, p);
+                }
+            }
+            else{
+                result = push(OpCode::Pow, base, exponent);
+            }
+            break;
+        }
+        case ExprKind::Exp:{
+            const ElementaryFunctions::Exp* exp = static_cast<const ElementaryFunctions::Exp*>(expr);
+            int base = emit(exp->get_base(), emitted);
+            int exponent = emit(exp->get_power(), emitted);
+            if (tape_[base].op == OpCode::Const && tape_[exponent].op != OpCode::Const){
+                result = push(OpCode::ExpConst, exponent, -1, std::log(tape_[base].value));
+            }
+            else{
+                result = push(OpCode::Exp, base, exponent);
+            }
+            break;
+        }
+        case ExprKind::Log:{
+            const ElementaryFunctions::Log* log = static_cast<const ElementaryFunctions::Log*>(expr);
+            int base = emit(log->get_base(), emitted);
+            int arg = emit(log->get_arg(), emitted);
+            if (tape_[base].op == OpCode::Const && tape_[arg].op != OpCode::Const){
+                result = push(OpCode::LogConst, arg, -1, 1 / std::log(tape_[base].value));
+            }
+            else{
+                result = push(OpCode::Log, base, arg);
+            }
+            break;
+        }
+        case ExprKind::Sin:
+            result = push(OpCode::Sin, emit(static_cast<const ElementaryFunctions::Sin*>(expr)->get_arg(), emitted));
+            break;
+        case ExprKind::Cos:
+            result = push(OpCode::Cos, emit(static_cast<const ElementaryFunctions::Cos*>(expr)->get_arg(), emitted));
+            break;
+        case ExprKind::Tan:
+            result = push(OpCode::Tan, emit(static_cast<const ElementaryFunctions::Tan*>(expr)->get_arg(), emitted));
+            break;
+        case ExprKind::Cot:
+            result = push(OpCode::Cot, emit(static_cast<const ElementaryFunctions::Cot*>(expr)->get_arg(), emitted));
+            break;
+    }
+
+    emitted.emplace(expr, result);
+    return result;
+}
+
+void CompiledExpression::remove_dead_code(int root){
+    // Folding leaves operands nobody reads; keep what the result depends on.
+    // Everything live precedes the root, so it ends up last.
+    std::vector<int> live(tape_.size(), 0);
+    live[root] = 1;
+    for (int i = root; i >= 0; --i){
+        if (!live[i] || tape_[i].op == OpCode::Var || tape_[i].op == OpCode::Const){
+            continue;
+        }
+        if (tape_[i].lhs >= 0){
+            live[tape_[i].lhs] = 1;
+        }
+        if (tape_[i].rhs >= 0){
+            live[tape_[i].rhs] = 1;
+        }
+    }
+
+    std::vector<int> index(tape_.size(), -1);
+    std::vector<Instruction> compacted;
+    for (int i = 0; i <= root; ++i){
+        if (!live[i]){
+            continue;
+        }
+        Instruction ins = tape_[i];
+        if (ins.op != OpCode::Var && ins.op != OpCode::Const){
+            ins.lhs = ins.lhs < 0 ? -1 : index[ins.lhs];
+            ins.rhs = ins.rhs < 0 ? -1 : index[ins.rhs];
+        }
+        index[i] = static_cast<int>(compacted.size());
+        compacted.push_back(ins);
+    }
+    tape_ = std::move(compacted);
+}
+
+double CompiledExpression::calculate(const double* values) const{
+    thread_local std::vector<double> registers;
+    if (registers.size() < tape_.size()){
+        registers.resize(tape_.size());
+    }
+    forward(values, registers.data());
+    return registers[tape_.size() - 1];
+}
+
+void CompiledExpression::forward(const double* values, double* r) const{
+    const Instruction* ins = tape_.data();
+    const size_t n = tape_.size();
+    for (size_t i = 0; i < n; ++i){
+        switch (ins[i].op){
+            case OpCode::Const: r[i] = ins[i].value; break;
+            case OpCode::Var: r[i] = values[ins[i].lhs]; break;
+            case OpCode::Add: r[i] = r[ins[i].lhs] + r[ins[i].rhs]; break;
+            case OpCode::Mul: r[i] = r[ins[i].lhs] * r[ins[i].rhs]; break;
+            case OpCode::Div: r[i] = r[ins[i].lhs] / r[ins[i].rhs]; break;
+            case OpCode::Square: r[i] = r[ins[i].lhs] * r[ins[i].lhs]; break;
+            default:
+                r[i] = apply(ins[i], r[ins[i].lhs], ins[i].rhs < 0 ? 0 : r[ins[i].rhs]);
+                break;
+        }
+    }
+}
+
+double CompiledExpression::calculate(const EvalContext& context) const{
+    thread_local std::vector<double> values;
+    values.resize(context_slots_.size());
+    for (size_t i = 0; i < context_slots_.size(); ++i){
+        values[i] = context.get(context_slots_[i]);
+    }
+    return calculate(values.data());
+}
+
+double CompiledExpression::calculate_gradient(const double* values, double* gradient) const{
+    const size_t n = tape_.size();
+    thread_local std::vector<double> registers;
+    thread_local std::vector<double> adjoints;
+    if (registers.size() < n){
+        registers.resize(n);
+    }
+    adjoints.assign(n, 0);
+    double* r = registers.data();
+    double* adj = adjoints.data();
+
+    forward(values, r);
+    std::fill(gradient, gradient + variables_.size(), 0.0);
+
+    // Reverse sweep: each instruction passes its adjoint on to its operands.
+    // Adjoints that reach constants are never read, so they are not guarded.
+    adj[n - 1] = 1;
+    for (size_t k = n; k-- > 0;){
+        const Instruction& ins = tape_[k];
+        double g = adj[k];
+        if (g == 0){
+            continue;
+        }
+        double a = ins.lhs >= 0 ? r[ins.lhs] : 0;
+        double b = ins.rhs >= 0 ? r[ins.rhs] : 0;
+        switch (ins.op){
+            case OpCode::Const:
+                break;
+            case OpCode::Var:
+                gradient[ins.lhs] += g;
+                break;
+            case OpCode::Add:
+                adj[ins.lhs] += g;
+                adj[ins.rhs] += g;
+                break;
+            case OpCode::Mul:
+                adj[ins.lhs] += g * b;
+                adj[ins.rhs] += g * a;
+                break;
+            case OpCode::Div:
+                adj[ins.lhs] += g / b;
+                adj[ins.rhs] -= g * r[k] / b;
+                break;
+            case OpCode::Square:
+                adj[ins.lhs] += 2 * g * a;
+                break;
+            case OpCode::Pow:
+                adj[ins.lhs] += g * b * std::pow(a, b - 1);
+                adj[ins.rhs] += g * r[k] * std::log(a);
+                break;
+            case OpCode::PowConst:
+                adj[ins.lhs] += g * ins.value * std::pow(a, ins.value - 1);
+                break;
+            case OpCode::ExpConst:
+                adj[ins.lhs] += g * r[k] * ins.value;
+                break;
+            case OpCode::Exp:
+                adj[ins.lhs] += g * r[k] * b / a;
+                adj[ins.rhs] += g * r[k] * std::log(a);
+                break;
+            case OpCode::LogConst:
+                adj[ins.lhs] += g * ins.value / a;
+                break;
+            case OpCode::Log:{
+                double log_base = std::log(a);
+                adj[ins.lhs] -= g * r[k] / (a * log_base);
+                adj[ins.rhs] += g / (b * log_base);
+                break;
+            }
+            case OpCode::Sin:
+                adj[ins.lhs] += g * std::cos(a);
+                break;
+            case OpCode::Cos:
+                adj[ins.lhs] -= g * std::sin(a);
+                break;
+            case OpCode::Tan:
+                adj[ins.lhs] += g * (1 + r[k] * r[k]);
+                break;
+            case OpCode::Cot:
+                adj[ins.lhs] -= g * (1 + r[k] * r[k]);
+                break;
+        }
+    }
+    return r[n - 1];
+}
+
+double CompiledExpression::calculate_gradient(const EvalContext& context, double* gradient) const{
+    thread_local std::vector<double> values;
+    values.resize(context_slots_.size());
+    for (size_t i = 0; i < context_slots_.size(); ++i){
+        values[i] = context.get(context_slots_[i]);
+    }
+    return calculate_gradient(values.data(), gradient);
+}
+
+void CompiledExpression::calculate_batch(const double* x, double* out, size_t count, int slot, const double* values) const{
+    const size_t n = tape_.size();
+    thread_local std::vector<double> registers;
+    thread_local std::vector<double> scratch;
+    thread_local std::vector<const double*> columns;
+    if (registers.size() < n * BATCH_BLOCK){
+        registers.resize(n * BATCH_BLOCK);
+    }
+    scratch.resize(BATCH_BLOCK);
+    columns.resize(n);
+
+    for (size_t start = 0; start < count; start += BATCH_BLOCK){
+        const size_t m = std::min(BATCH_BLOCK, count - start);
+
+        for (size_t i = 0; i < n; ++i){
+            const Instruction& ins = tape_[i];
+            double* r = registers.data() + i * BATCH_BLOCK;
+            const double* a = ins.lhs >= 0 && ins.op != OpCode::Var ? columns[ins.lhs] : nullptr;
+            const double* b = ins.rhs >= 0 ? columns[ins.rhs] : nullptr;
+            columns[i] = r;
+
+            switch (ins.op){
+                case OpCode::Const:
+                    std::fill(r, r + m, ins.value);
+                    break;
+                case OpCode::Var:
+                    if (ins.lhs == slot){
+                        columns[i] = x + start;
+                    }
+                    else{
+                        std::fill(r, r + m, values ? values[ins.lhs] : 0.0);
+                    }
+                    break;
+                case OpCode::Add: VectorMath::add(a, b, r, m); break;
+                case OpCode::Mul: VectorMath::mul(a, b, r, m); break;
+                case OpCode::Div: VectorMath::div(a, b, r, m); break;
+                case OpCode::Square: VectorMath::mul(a, a, r, m); break;
+                case OpCode::Pow: VectorMath::pow(a, b, r, m); break;
+                case OpCode::PowConst: VectorMath::pow_const(a, ins.value, r, m); break;
+                case OpCode::ExpConst:
+                    VectorMath::scale(a, ins.value, r, m);
+                    VectorMath::exp(r, r, m);
+                    break;
+                case OpCode::Exp:
+                    VectorMath::log(a, r, m);
+                    VectorMath::mul(b, r, r, m);
+                    VectorMath::exp(r, r, m);
+                    break;
+                case OpCode::LogConst:
+                    VectorMath::log(a, r, m);
+                    VectorMath::scale(r, ins.value, r, m);
+                    break;
+                case OpCode::Log:
+                    VectorMath::log(a, scratch.data(), m);
+                    VectorMath::log(b, r, m);
+                    VectorMath::div(r, scratch.data(), r, m);
+                    break;
+                case OpCode::Sin: VectorMath::sin(a, r, m); break;
+                case OpCode::Cos: VectorMath::cos(a, r, m); break;
+                case OpCode::Tan: VectorMath::tan(a, r, m); break;
+                case OpCode::Cot: VectorMath::cot(a, r, m); break;
+            }
+        }
+        std::copy(columns[n - 1], columns[n - 1] + m, out + start);
+    }
+}
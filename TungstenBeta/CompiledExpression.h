@@ -0,0 +1,68 @@
+#ifndef COMPILED_EXPRESSION_H
+#define COMPILED_EXPRESSION_H
+
+#include "Expression.h"
+
+// An expression lowered to a linear tape for fast repeated evaluation.
+// Every instruction writes one register (its own index) and reads earlier
+// registers only. Variable-free subtrees are folded into constants at
+// compile time, shared subtrees are emitted once and variables are resolved
+// to dense slots, so evaluation is a single loop without virtual calls,
+// string lookups or allocations.
+class CompiledExpression{
+public:
+    enum class OpCode : unsigned char{
+        Const, Var,
+        Add, Mul, Div,
+        Square, Pow, PowConst, ExpConst, Exp, LogConst, Log,
+        Sin, Cos, Tan, Cot
+    };
+
+    struct Instruction{
+        OpCode op;
+        int lhs;
+        int rhs;
+        double value;
+    };
+
+    explicit CompiledExpression(const Expression* expr);
+
+    // Slot of a variable or -1 if the expression does not depend on it
+    int slot(const std::string& name) const;
+    const std::vector<std::string>& variables() const { return variables_; }
+    const std::vector<Instruction>& instructions() const { return tape_; }
+    size_t size() const { return tape_.size(); }
+
+    // values[i] is the value of variables()[i]
+    double calculate(const double* values) const;
+    // Reads the variable values from context
+    double calculate(const EvalContext& context) const;
+
+    // Reverse-mode differentiation: one forward and one backward sweep over
+    // the tape write gradient[i] = d/d variables()[i] for all variables at
+    // once and return the value.
+    double calculate_gradient(const double* values, double* gradient) const;
+    double calculate_gradient(const EvalContext& context, double* gradient) const;
+
+    // Evaluates the expression at count points: the variable in the given
+    // slot takes the values x[0..count), the others are read from values
+    // (which may be null when there are none). Points are processed in
+    // blocks, one instruction at a time, with vectorized kernels.
+    void calculate_batch(const double* x, double* out, size_t count, int slot = 0, const double* values = nullptr) const;
+
+private:
+    static constexpr size_t BATCH_BLOCK = 256;
+
+    std::vector<Instruction> tape_;
+    std::vector<std::string> variables_;
+    // EvalContext slot of each entry of variables_
+    std::vector<int> context_slots_;
+
+    int emit(const Expression* expr, std::unordered_map<const Expression*, int>& emitted);
+    int push(OpCode op, int lhs = -1, int rhs = -1, double value = 0);
+    int variable_slot(const std::string& name);
+    void forward(const double* values, double* registers) const;
+    void remove_dead_code(int root);
+};
+
+#endif // COMPILED_EXPRESSION_H
@@ -6,37 +6,53 @@ const Expression* Constant::pi = new Constant;
 const Expression* Constant::ZERO = new Constant(0);
 const Expression* Constant::ONE = new Constant(1);
 
-Constant::Constant(long long value){
+Constant::Constant(long long value) : Expression(ExprKind::Constant){
     value_ = value;
+    approximation_ = static_cast<double>(value);
 }
 
-Constant::Constant(){
+Constant::Constant(const Rational& value) : Expression(ExprKind::Constant){
+    value_ = value;
+    approximation_ = value.to_double();
+}
+
+Constant::Constant() : Expression(ExprKind::Constant){
+    value_ = 0;
+    approximation_ = 0;
 }
 
-double Constant::calculate() const{
+double Constant::calculate(const EvalContext& context) const{
     if (this == Constant::e){
-        return 2.718281828;
+        return M_E;
     }
-    return value_;
+    if (this == Constant::pi){
+        return M_PI;
+    }
+    return approximation_;
 }
 
-int Constant::get_exact_value() const{
-    return value_;
+Dual Constant::calculate_dual(const EvalContext& context, int slot) const{
+    return Dual{calculate(context), 0};
 }
 
-const Expression* Constant::simplify() const{
-    return this;
+Interval Constant::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    double value = calculate(context);
+    // Integers up to 2^53 are exact doubles; e, pi and fractions were rounded
+    if (this != Constant::e && this != Constant::pi && value_.is_integer() && std::fabs(value) <= 9007199254740992.0){
+        return Interval::point(value);
+    }
+    return Interval{std::nextafter(value, -INFINITY), std::nextafter(value, INFINITY)};
 }
 
-const Expression* Constant::plug_variable(const std::string& variable) const{
+const Expression* Constant::compute_simplify() const{
     return this;
 }
 
-const Expression* Constant::copy() const{
-    return new Constant(value_);
+const Expression* Constant::plug_variable(const std::string& variable, const Expression* value) const{
+    return this;
 }
 
-const Expression* Constant::complex_derivative(const std::string& variable) const{
+const Expression* Constant::compute_derivative(const std::string& variable) const{
     return Constant::ZERO;
 }
 
@@ -44,10 +60,38 @@ std::string Constant::to_string() const{
     if (this == Constant::e){
         return "e";
     }
-    if (value_ >= 0){
-        return std::to_string(value_);
+    if (this == Constant::pi){
+        return "pi";
+    }
+    if (value_.is_integer() && !value_.is_negative()){
+        return value_.to_string();
     }
     else{
-        return "(" + std::to_string(value_) + ")";
+        return "(" + value_.to_string() + ")";
+    }
+}
+
+bool Constant::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    // e and pi are identified by address only
+    if (this == Constant::e || this == Constant::pi || &other == Constant::e || &other == Constant::pi){
+        return false;
+    }
+    if (other.kind() != ExprKind::Constant){
+        return false;
+    }
+    const Constant* constant = static_cast<const Constant*>(&other);
+    return constant->value_ == value_;
+}
+
+size_t Constant::compute_hash() const{
+    if (this == Constant::e){
+        return string_hash("e");
+    }
+    if (this == Constant::pi){
+        return string_hash("pi");
     }
+    return combine_hash(string_hash("Constant"), value_.hash());
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define CONSTANT_H
 
 #include "Expression.h"
+#include "Rational.h"
 
 class Constant : public Expression{
 public:
@@ -11,19 +12,26 @@ public:
     static const Expression* ONE;
 
     Constant(long long value);
+    Constant(const Rational& value);
     Constant();
 
 
-    double calculate() const override;
-    int get_exact_value() const;
-    const Expression* complex_derivative(const std::string& variable) const override;
-    const Expression* plug_variable(const std::string& variable) const override;
-    const Expression* copy() const override;
-    const Expression* simplify() const override;
+    double calculate(const EvalContext& context) const override;
+    Dual calculate_dual(const EvalContext& context, int slot) const override;
+    Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
+    const Rational& get_value() const { return value_; }
+    const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
     std::string to_string() const override;
+    bool equals(const Expression& other) const override;
 
 private:
-    long long value_;
+    Rational value_;
+    // value_ rounded once, so evaluation never touches the exact form
+    double approximation_;
+
+    size_t compute_hash() const override;
+    const Expression* compute_simplify() const override;
+    const Expression* compute_derivative(const std::string& variable) const override;
 };
 
 
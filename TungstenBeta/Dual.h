@@ -0,0 +1,24 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+// Value of an expression together with its derivative with respect to one
+// variable (forward-mode automatic differentiation). Expression::calculate_dual
+// produces both in a single traversal without building a derivative tree.
+struct Dual{
+    double value;
+    double derivative;
+};
+
+inline Dual operator+(Dual lhs, Dual rhs){
+    return Dual{lhs.value + rhs.value, lhs.derivative + rhs.derivative};
+}
+
+inline Dual operator*(Dual lhs, Dual rhs){
+    return Dual{lhs.value * rhs.value, lhs.derivative * rhs.value + lhs.value * rhs.derivative};
+}
+
+inline Dual operator/(Dual lhs, Dual rhs){
+    return Dual{lhs.value / rhs.value, (lhs.derivative * rhs.value - lhs.value * rhs.derivative) / (rhs.value * rhs.value)};
+}
+
+#endif // DUAL_H
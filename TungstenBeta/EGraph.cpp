@@ -0,0 +1,637 @@
+#include "EGraph.h"
+#include "Constant.h"
+#include "ExpressionFactory.h"
+#include "ExpressionVisitor.h"
+
+#include <limits>
+
+namespace{
+    typedef std::vector<std::pair<int, std::function<int()>>> Rewrites;
+
+    bool checked_add(long long a, long long b, long long& result){
+        return !__builtin_add_overflow(a, b, &result);
+    }
+
+    bool checked_mul(long long a, long long b, long long& result){
+        return !__builtin_mul_overflow(a, b, &result);
+    }
+
+    bool checked_pow(long long base, long long exponent, long long& result){
+        if (exponent < 0 || exponent > 64){
+            return false;
+        }
+        result = 1;
+        for (long long i = 0; i < exponent; ++i){
+            if (!checked_mul(result, base, result)){
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+size_t EGraph::ENodeHash::operator()(const ENode& node) const{
+    size_t h = static_cast<size_t>(node.kind) * 0x9e3779b97f4a7c15ULL;
+    h ^= std::hash<long long>()(node.value) + (h << 6) + (h >> 2);
+    h ^= std::hash<const Expression*>()(node.leaf) + (h << 6) + (h >> 2);
+    for (int child : node.children){
+        h ^= std::hash<int>()(child) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+const Expression* EGraph::simplify(const Expression* expr, int max_iterations, size_t max_nodes){
+    EGraph graph;
+    int root = graph.add(expr);
+    // The greedy result is one more known equal form, so extraction never
+    // does worse than simplify() even where the rules cannot reach it
+    graph.merge(root, graph.add(expr->simplify()));
+    graph.saturate(max_iterations, max_nodes);
+    return graph.extract(root);
+}
+
+int EGraph::find(int id) const{
+    while (parent_[id] != id){
+        parent_[id] = parent_[parent_[id]];
+        id = parent_[id];
+    }
+    return id;
+}
+
+size_t EGraph::class_count() const{
+    size_t count = 0;
+    for (size_t i = 0; i < parent_.size(); ++i){
+        count += find(static_cast<int>(i)) == static_cast<int>(i);
+    }
+    return count;
+}
+
+EGraph::ENode EGraph::canonicalize(ENode node) const{
+    for (int& child : node.children){
+        child = find(child);
+    }
+    return node;
+}
+
+bool EGraph::is_constant(int id, long long value) const{
+    const EClass& eclass = classes_[find(id)];
+    return eclass.constant && eclass.value == value;
+}
+
+bool EGraph::fold(const ENode& node, long long& value) const{
+    if (node.kind == ExprKind::Constant){
+        value = node.value;
+        return node.leaf == nullptr;
+    }
+    for (int child : node.children){
+        if (!classes_[find(child)].constant){
+            return false;
+        }
+    }
+    auto operand = [&](int i){ return classes_[find(node.children[i])].value; };
+    switch (node.kind){
+        case ExprKind::Sum:
+            return checked_add(operand(0), operand(1), value);
+        case ExprKind::Product:
+            return checked_mul(operand(0), operand(1), value);
+        case ExprKind::Fraction:
+            if (operand(1) == 0 || operand(0) % operand(1) != 0){
+                return false;
+            }
+            value = operand(0) / operand(1);
+            return true;
+        case ExprKind::Power:
+        case ExprKind::Exp:
+            return checked_pow(operand(0), operand(1), value);
+        default:
+            return false;
+    }
+}
+
+int EGraph::add(ENode node){
+    node = canonicalize(std::move(node));
+    auto it = memo_.find(node);
+    if (it != memo_.end()){
+        return find(it->second);
+    }
+
+    int id = static_cast<int>(classes_.size());
+    parent_.push_back(id);
+    classes_.emplace_back();
+    for (int child : node.children){
+        classes_[child].parents.emplace_back(node, id);
+    }
+    long long value;
+    bool constant = fold(node, value);
+    classes_[id].nodes.push_back(node);
+    memo_.emplace(std::move(node), id);
+
+    if (constant){
+        classes_[id].constant = true;
+        classes_[id].value = value;
+        int leaf = make_constant(value);
+        merge(id, leaf);
+    }
+    return find(id);
+}
+
+int EGraph::make(ExprKind kind, std::vector<int> children){
+    return add(ENode{kind, 0, nullptr, std::move(children)});
+}
+
+int EGraph::make_constant(long long value){
+    return add(ENode{ExprKind::Constant, value, nullptr, {}});
+}
+
+int EGraph::add(const Expression* expr){
+    switch (expr->kind()){
+        case ExprKind::Constant:
+            // Folding works on 64-bit integers; fractions and big values are opaque
+            if (expr == Constant::e || expr == Constant::pi || !static_cast<const Constant*>(expr)->get_value().is_small_integer()){
+                return add(ENode{ExprKind::Constant, 0, expr, {}});
+            }
+            return make_constant(static_cast<const Constant*>(expr)->get_value().numerator());
+        case ExprKind::Variable:
+            return add(ENode{ExprKind::Variable, 0, expr, {}});
+        case ExprKind::Sum:
+        case ExprKind::Product:{
+            int result = -1;
+            for (const Expression* child : children(expr)){
+                int operand = add(child);
+                result = result < 0 ? operand : make(expr->kind(), {result, operand});
+            }
+            return result < 0 ? make_constant(expr->kind() == ExprKind::Sum ? 0 : 1) : result;
+        }
+        default:{
+            std::vector<int> ids;
+            for (const Expression* child : children(expr)){
+                ids.push_back(add(child));
+            }
+            return make(expr->kind(), std::move(ids));
+        }
+    }
+}
+
+bool EGraph::merge(int a, int b){
+    a = find(a);
+    b = find(b);
+    if (a == b){
+        return false;
+    }
+    if (classes_[a].nodes.size() + classes_[a].parents.size() < classes_[b].nodes.size() + classes_[b].parents.size()){
+        std::swap(a, b);
+    }
+    parent_[b] = a;
+
+    EClass& from = classes_[b];
+    EClass& into = classes_[a];
+    into.nodes.insert(into.nodes.end(), from.nodes.begin(), from.nodes.end());
+    into.parents.insert(into.parents.end(), from.parents.begin(), from.parents.end());
+    if (from.constant && !into.constant){
+        into.constant = true;
+        into.value = from.value;
+    }
+    from.nodes.clear();
+    from.parents.clear();
+    from.nodes.shrink_to_fit();
+    from.parents.shrink_to_fit();
+    pending_.push_back(a);
+    return true;
+}
+
+void EGraph::repair(int id){
+    // Parents may now be congruent: same kind over the same classes
+    std::vector<std::pair<ENode, int>> parents = std::move(classes_[id].parents);
+    for (const auto& parent : parents){
+        memo_.erase(parent.first);
+    }
+    std::unordered_map<ENode, int, ENodeHash> unique;
+    for (const auto& parent : parents){
+        ENode node = canonicalize(parent.first);
+        auto it = unique.find(node);
+        if (it != unique.end()){
+            merge(parent.second, it->second);
+        }
+        unique[node] = find(parent.second);
+    }
+
+    id = find(id);
+    for (const auto& parent : unique){
+        memo_[parent.first] = find(parent.second);
+        classes_[id].parents.push_back(parent);
+    }
+
+    // A class that just became constant gets its literal
+    if (classes_[id].constant){
+        merge(id, make_constant(classes_[id].value));
+    }
+}
+
+void EGraph::rebuild(){
+    while (!pending_.empty()){
+        std::vector<int> todo;
+        todo.swap(pending_);
+        for (int& id : todo){
+            id = find(id);
+        }
+        std::sort(todo.begin(), todo.end());
+        todo.erase(std::unique(todo.begin(), todo.end()), todo.end());
+        for (int id : todo){
+            repair(id);
+        }
+    }
+
+    // Drop duplicate e-nodes left behind by merges
+    for (size_t i = 0; i < classes_.size(); ++i){
+        if (find(static_cast<int>(i)) != static_cast<int>(i)){
+            continue;
+        }
+        std::vector<ENode> nodes;
+        std::unordered_map<ENode, int, ENodeHash> seen;
+        for (const ENode& node : classes_[i].nodes){
+            ENode canonical = canonicalize(node);
+            if (seen.emplace(canonical, 0).second){
+                nodes.push_back(std::move(canonical));
+            }
+        }
+        classes_[i].nodes = std::move(nodes);
+    }
+}
+
+void EGraph::for_each(int id, ExprKind kind, const std::function<void(const ENode&)>& f) const{
+    for (const ENode& node : classes_[find(id)].nodes){
+        if (node.kind == kind){
+            f(node);
+        }
+    }
+}
+
+void EGraph::match(int id, const ENode& node, Rewrites& rewrites){
+    auto same = [this](int a, int b){ return find(a) == find(b); };
+    auto rewrite = [&](std::function<int()> f){ rewrites.emplace_back(id, std::move(f)); };
+
+    switch (node.kind){
+        case ExprKind::Sum:
+        case ExprKind::Product:{
+            ExprKind kind = node.kind;
+            bool sum = kind == ExprKind::Sum;
+            int a = node.children[0];
+            int b = node.children[1];
+
+            rewrite([=]{ return make(kind, {b, a}); });
+            for_each(a, kind, [&](const ENode& inner){
+                int x = inner.children[0];
+                int y = inner.children[1];
+                rewrite([=]{ return make(kind, {x, make(kind, {y, b})}); });
+            });
+
+            if (is_constant(a, sum ? 0 : 1)){
+                rewrite([=]{ return b; });
+            }
+            if (sum){
+                if (same(a, b)){
+                    rewrite([=]{ return make(ExprKind::Product, {make_constant(2), a}); });
+                }
+                // x*y + x*z = x*(y + z)
+                for_each(a, ExprKind::Product, [&](const ENode& lhs){
+                    for_each(b, ExprKind::Product, [&](const ENode& rhs){
+                        if (same(lhs.children[0], rhs.children[0])){
+                            int x = lhs.children[0];
+                            int y = lhs.children[1];
+                            int z = rhs.children[1];
+                            rewrite([=]{ return make(ExprKind::Product, {x, make(ExprKind::Sum, {y, z})}); });
+                        }
+                    });
+                });
+                // a + a*y = a*(1 + y)
+                for_each(b, ExprKind::Product, [&](const ENode& rhs){
+                    if (same(rhs.children[0], a)){
+                        int y = rhs.children[1];
+                        rewrite([=]{ return make(ExprKind::Product, {a, make(ExprKind::Sum, {make_constant(1), y})}); });
+                    }
+                });
+                // x/z + y/z = (x + y)/z
+                for_each(a, ExprKind::Fraction, [&](const ENode& lhs){
+                    for_each(b, ExprKind::Fraction, [&](const ENode& rhs){
+                        if (same(lhs.children[1], rhs.children[1])){
+                            int x = lhs.children[0];
+                            int y = rhs.children[0];
+                            int z = lhs.children[1];
+                            rewrite([=]{ return make(ExprKind::Fraction, {make(ExprKind::Sum, {x, y}), z}); });
+                        }
+                    });
+                });
+                // sin(t)^2 + cos(t)^2 = 1
+                for_each(a, ExprKind::Power, [&](const ENode& lhs){
+                    if (!is_constant(lhs.children[1], 2)){
+                        return;
+                    }
+                    for_each(b, ExprKind::Power, [&](const ENode& rhs){
+                        if (!is_constant(rhs.children[1], 2)){
+                            return;
+                        }
+                        for_each(lhs.children[0], ExprKind::Sin, [&](const ENode& sin){
+                            for_each(rhs.children[0], ExprKind::Cos, [&](const ENode& cos){
+                                if (same(sin.children[0], cos.children[0])){
+                                    rewrite([=]{ return make_constant(1); });
+                                }
+                            });
+                        });
+                    });
+                });
+            }
+            else{
+                if (is_constant(a, 0)){
+                    rewrite([=]{ return make_constant(0); });
+                }
+                if (same(a, b)){
+                    rewrite([=]{ return make(ExprKind::Power, {a, make_constant(2)}); });
+                }
+                // a*(x + y) = a*x + a*y, the expansion greedy simplification cannot undo
+                for_each(b, ExprKind::Sum, [&](const ENode& rhs){
+                    int x = rhs.children[0];
+                    int y = rhs.children[1];
+                    rewrite([=]{ return make(ExprKind::Sum, {make(ExprKind::Product, {a, x}), make(ExprKind::Product, {a, y})}); });
+                });
+                // a * a^n = a^(n + 1)
+                for_each(b, ExprKind::Power, [&](const ENode& rhs){
+                    if (same(rhs.children[0], a)){
+                        int n = rhs.children[1];
+                        rewrite([=]{ return make(ExprKind::Power, {a, make(ExprKind::Sum, {n, make_constant(1)})}); });
+                    }
+                });
+                // x^m * x^n = x^(m + n), likewise for Exp
+                for (ExprKind power : {ExprKind::Power, ExprKind::Exp}){
+                    for_each(a, power, [&](const ENode& lhs){
+                        for_each(b, power, [&](const ENode& rhs){
+                            if (same(lhs.children[0], rhs.children[0])){
+                                int x = lhs.children[0];
+                                int m = lhs.children[1];
+                                int n = rhs.children[1];
+                                rewrite([=]{ return make(power, {x, make(ExprKind::Sum, {m, n})}); });
+                            }
+                        });
+                    });
+                }
+                // a * (x/y) = (a*x)/y
+                for_each(b, ExprKind::Fraction, [&](const ENode& rhs){
+                    int x = rhs.children[0];
+                    int y = rhs.children[1];
+                    rewrite([=]{ return make(ExprKind::Fraction, {make(ExprKind::Product, {a, x}), y}); });
+                });
+            }
+            break;
+        }
+        case ExprKind::Fraction:{
+            int a = node.children[0];
+            int b = node.children[1];
+            if (is_constant(b, 1)){
+                rewrite([=]{ return a; });
+            }
+            if (is_constant(a, 0) || (same(a, b) && !is_constant(b, 0))){
+                long long value = is_constant(a, 0) ? 0 : 1;
+                rewrite([=]{ return make_constant(value); });
+            }
+            // (x/y)/b = x/(y*b)
+            for_each(a, ExprKind::Fraction, [&](const ENode& lhs){
+                int x = lhs.children[0];
+                int y = lhs.children[1];
+                rewrite([=]{ return make(ExprKind::Fraction, {x, make(ExprKind::Product, {y, b})}); });
+            });
+            // (x*y)/x = y
+            for_each(a, ExprKind::Product, [&](const ENode& lhs){
+                if (same(lhs.children[0], b)){
+                    int y = lhs.children[1];
+                    rewrite([=]{ return y; });
+                }
+            });
+            // sin/cos = tan, cos/sin = cot, 1/tan = cot, 1/cot = tan
+            for_each(a, ExprKind::Sin, [&](const ENode& sin){
+                for_each(b, ExprKind::Cos, [&](const ENode& cos){
+                    if (same(sin.children[0], cos.children[0])){
+                        int t = sin.children[0];
+                        rewrite([=]{ return make(ExprKind::Tan, {t}); });
+                    }
+                });
+            });
+            for_each(a, ExprKind::Cos, [&](const ENode& cos){
+                for_each(b, ExprKind::Sin, [&](const ENode& sin){
+                    if (same(sin.children[0], cos.children[0])){
+                        int t = sin.children[0];
+                        rewrite([=]{ return make(ExprKind::Cot, {t}); });
+                    }
+                });
+            });
+            if (is_constant(a, 1)){
+                for_each(b, ExprKind::Tan, [&](const ENode& tan){
+                    int t = tan.children[0];
+                    rewrite([=]{ return make(ExprKind::Cot, {t}); });
+                });
+                for_each(b, ExprKind::Cot, [&](const ENode& cot){
+                    int t = cot.children[0];
+                    rewrite([=]{ return make(ExprKind::Tan, {t}); });
+                });
+            }
+            break;
+        }
+        case ExprKind::Power:
+        case ExprKind::Exp:{
+            ExprKind kind = node.kind;
+            int a = node.children[0];
+            int b = node.children[1];
+            if (is_constant(b, 1)){
+                rewrite([=]{ return a; });
+            }
+            if (is_constant(b, 0) || is_constant(a, 1)){
+                rewrite([=]{ return make_constant(1); });
+            }
+            // (x^m)^n = x^(m*n) for integer n
+            if (classes_[find(b)].constant){
+                for_each(a, kind, [&](const ENode& inner){
+                    int x = inner.children[0];
+                    int m = inner.children[1];
+                    rewrite([=]{ return make(kind, {x, make(ExprKind::Product, {m, b})}); });
+                });
+            }
+            // b^log_b(x) = x
+            for_each(b, ExprKind::Log, [&](const ENode& log){
+                if (same(log.children[0], a)){
+                    int x = log.children[1];
+                    rewrite([=]{ return x; });
+                }
+            });
+            break;
+        }
+        case ExprKind::Log:{
+            int a = node.children[0];
+            int b = node.children[1];
+            if (same(a, b)){
+                rewrite([=]{ return make_constant(1); });
+            }
+            if (is_constant(b, 1)){
+                rewrite([=]{ return make_constant(0); });
+            }
+            // log_b(b^x) = x
+            for (ExprKind power : {ExprKind::Power, ExprKind::Exp}){
+                for_each(b, power, [&](const ENode& inner){
+                    if (same(inner.children[0], a)){
+                        int x = inner.children[1];
+                        rewrite([=]{ return x; });
+                    }
+                });
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void EGraph::saturate(int max_iterations, size_t max_nodes){
+    rebuild();
+    for (int iteration = 0; iteration < max_iterations && memo_.size() < max_nodes; ++iteration){
+        // Matching is bounded as well: late iterations can match far more
+        // often than there is room left for new nodes
+        Rewrites rewrites;
+        for (size_t i = 0; i < classes_.size() && rewrites.size() < max_nodes; ++i){
+            if (find(static_cast<int>(i)) != static_cast<int>(i)){
+                continue;
+            }
+            for (const ENode& node : classes_[i].nodes){
+                match(static_cast<int>(i), node, rewrites);
+            }
+        }
+
+        // Matches were collected first; applying them only adds to the graph
+        size_t nodes = memo_.size();
+        bool merged = false;
+        for (auto& rewrite : rewrites){
+            merged = merge(rewrite.first, rewrite.second()) || merged;
+            if (memo_.size() >= max_nodes){
+                break;
+            }
+        }
+        rebuild();
+        if (!merged && memo_.size() == nodes){
+            break;
+        }
+    }
+}
+
+double EGraph::node_cost(const ENode& node){
+    switch (node.kind){
+        case ExprKind::Constant:
+        case ExprKind::Variable:
+        case ExprKind::Sum:
+        case ExprKind::Product:
+            return 1;
+        case ExprKind::Fraction:
+            return 2;
+        case ExprKind::Power:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+const Expression* EGraph::extract(int root){
+    rebuild();
+
+    // Cheapest e-node of every class, found by relaxing until nothing improves
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> cost(classes_.size(), INF);
+    std::vector<const ENode*> best(classes_.size(), nullptr);
+    bool changed = true;
+    while (changed){
+        changed = false;
+        for (size_t i = 0; i < classes_.size(); ++i){
+            if (find(static_cast<int>(i)) != static_cast<int>(i)){
+                continue;
+            }
+            for (const ENode& node : classes_[i].nodes){
+                double total = node_cost(node);
+                for (int child : node.children){
+                    total += cost[find(child)];
+                }
+                if (total < cost[i]){
+                    cost[i] = total;
+                    best[i] = &node;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    std::unordered_map<int, const Expression*> built;
+    std::function<const Expression*(int)> build = [&](int id) -> const Expression*{
+        id = find(id);
+        auto it = built.find(id);
+        if (it != built.end()){
+            return it->second;
+        }
+
+        const ENode& node = *best[id];
+        const Expression* result = nullptr;
+        switch (node.kind){
+            case ExprKind::Constant:
+                result = node.leaf != nullptr ? node.leaf : ExpressionFactory::make_constant(node.value);
+                break;
+            case ExprKind::Variable:
+                result = node.leaf;
+                break;
+            case ExprKind::Sum:
+            case ExprKind::Product:{
+                // Flatten the binary chain back into one n-ary node
+                std::vector<const Expression*> operands;
+                std::vector<int> stack = {node.children[1], node.children[0]};
+                while (!stack.empty()){
+                    int child = find(stack.back());
+                    stack.pop_back();
+                    if (best[child]->kind == node.kind){
+                        stack.push_back(best[child]->children[1]);
+                        stack.push_back(best[child]->children[0]);
+                    }
+                    else{
+                        operands.push_back(build(child));
+                    }
+                }
+                // Canonical order, numeric coefficients first like the greedy simplifier
+                std::sort(operands.begin(), operands.end(), canonical_less);
+                std::stable_partition(operands.begin(), operands.end(), [](const Expression* e){
+                    return e->kind() == ExprKind::Constant && e != Constant::e && e != Constant::pi;
+                });
+                result = node.kind == ExprKind::Sum
+                    ? ExpressionFactory::make_sum(std::move(operands))
+                    : ExpressionFactory::make_product(std::move(operands));
+                break;
+            }
+            case ExprKind::Fraction:
+                result = ExpressionFactory::make_fraction(build(node.children[0]), build(node.children[1]));
+                break;
+            case ExprKind::Power:
+                result = ExpressionFactory::make_power(build(node.children[0]), build(node.children[1]));
+                break;
+            case ExprKind::Exp:
+                result = ExpressionFactory::make_exp(build(node.children[0]), build(node.children[1]));
+                break;
+            case ExprKind::Log:
+                result = ExpressionFactory::make_log(build(node.children[0]), build(node.children[1]));
+                break;
+            case ExprKind::Sin:
+                result = ExpressionFactory::make_sin(build(node.children[0]));
+                break;
+            case ExprKind::Cos:
+                result = ExpressionFactory::make_cos(build(node.children[0]));
+                break;
+            case ExprKind::Tan:
+                result = ExpressionFactory::make_tan(build(node.children[0]));
+                break;
+            case ExprKind::Cot:
+                result = ExpressionFactory::make_cot(build(node.children[0]));
+                break;
+        }
+        built.emplace(id, result);
+        return result;
+    };
+    return build(root);
+}
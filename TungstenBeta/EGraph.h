@@ -0,0 +1,81 @@
+#ifndef EGRAPH_H
+#define EGRAPH_H
+
+#include "Expression.h"
+
+#include <functional>
+
+// Equality saturation. An e-graph stores many equivalent forms of an
+// expression at once: every e-class is a set of e-nodes known to be equal,
+// and e-nodes point at e-classes instead of single children. Rewrite rules
+// only ever add equalities, so no rewrite can block a better one later (the
+// greedy simplify() has to choose). After saturation the cheapest form of
+// the root is extracted with a cost model that approximates evaluation cost.
+//
+// Sums and products are stored as binary nodes; commutativity and
+// associativity are ordinary rules and extraction flattens them again.
+class EGraph{
+public:
+    struct ENode{
+        ExprKind kind;
+        // Exact value of numeric constants
+        long long value;
+        // Variables and symbolic constants (e, pi) are kept as their nodes
+        const Expression* leaf;
+        std::vector<int> children;
+
+        bool operator==(const ENode& other) const{
+            return kind == other.kind && value == other.value && leaf == other.leaf && children == other.children;
+        }
+    };
+
+    struct ENodeHash{
+        size_t operator()(const ENode& node) const;
+    };
+
+    // Saturates with the built-in rules, seeded with the result of
+    // simplify(), and returns the cheapest equivalent expression; stops
+    // early after max_iterations or max_nodes e-nodes
+    static const Expression* simplify(const Expression* expr, int max_iterations = 8, size_t max_nodes = 5000);
+
+    int add(const Expression* expr);
+    // Runs the rules until nothing changes or a limit is hit
+    void saturate(int max_iterations, size_t max_nodes);
+    const Expression* extract(int id);
+
+    int find(int id) const;
+    size_t node_count() const { return memo_.size(); }
+    size_t class_count() const;
+
+private:
+    struct EClass{
+        std::vector<ENode> nodes;
+        std::vector<std::pair<ENode, int>> parents;
+        // Constant folding analysis
+        bool constant = false;
+        long long value = 0;
+    };
+
+    mutable std::vector<int> parent_;
+    std::vector<EClass> classes_;
+    std::unordered_map<ENode, int, ENodeHash> memo_;
+    std::vector<int> pending_;
+
+    int add(ENode node);
+    int make(ExprKind kind, std::vector<int> children);
+    int make_constant(long long value);
+    bool merge(int a, int b);
+    void rebuild();
+    void repair(int id);
+    ENode canonicalize(ENode node) const;
+    bool fold(const ENode& node, long long& value) const;
+    bool is_constant(int id, long long value) const;
+
+    // Calls f for every e-node of the given kind in the class of id
+    void for_each(int id, ExprKind kind, const std::function<void(const ENode&)>& f) const;
+    void match(int id, const ENode& node, std::vector<std::pair<int, std::function<int()>>>& rewrites);
+
+    static double node_cost(const ENode& node);
+};
+
+#endif // EGRAPH_H
@@ -1,44 +1,60 @@
 #include "ElementaryFunctions.h"
 #include "operators.h"
 #include "Constant.h"
+#include "ExpressionFactory.h"
 
 namespace ElementaryFunctions{
-const Expression* ElementaryFunction::complex_derivative(const std::string& variable) const{
-    return (new operators::Product({this->derivative(variable), (this->get_input())->complex_derivative(variable)}))->simplify();
+const Expression* ElementaryFunction::compute_derivative(const std::string& variable) const{
+    return ExpressionFactory::make_product({this->derivative(variable), (this->get_input())->complex_derivative(variable)})->simplify();
 }
 
-ElementaryFunction::ElementaryFunction() = default;
+ElementaryFunction::ElementaryFunction(ExprKind kind) : Expression(kind) {}
 ElementaryFunction::~ElementaryFunction() = default;
 
 
 // Power
-Power::Power(const Expression* base, const Expression* power){
+Power::Power(const Expression* base, const Expression* power) : ElementaryFunction(ExprKind::Power){
     base_ = base;
     power_ = power;
 }
 
-double Power::calculate() const{
-    return std::pow(base_->calculate(), power_->calculate());
+double Power::calculate(const EvalContext& context) const{
+    return std::pow(base_->calculate(context), power_->calculate(context));
 }
 
-const Expression* Power::copy() const{
-    return (new Power(base_, power_))->simplify();
+Dual Power::calculate_dual(const EvalContext& context, int slot) const{
+    Dual base = base_->calculate_dual(context, slot);
+    Dual power = power_->calculate_dual(context, slot);
+    double value = std::pow(base.value, power.value);
+    if (power.derivative == 0){
+        // Constant exponent: also valid for negative bases
+        return Dual{value, power.value * std::pow(base.value, power.value - 1) * base.derivative};
+    }
+    return Dual{value, value * (power.derivative * std::log(base.value) + power.value * base.derivative / base.value)};
+}
+
+Interval Power::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return Interval::pow(base_->calculate_interval(context, slot, range), power_->calculate_interval(context, slot, range));
 }
 
-const Expression* Power::simplify() const{
-    if (base_->simplify() == Constant::ONE){
+const Expression* Power::compute_simplify() const{
+    const Expression* base = base_->simplify();
+    const Expression* power = power_->simplify();
+
+    if (base == Constant::ONE){
         return Constant::ONE;
     }
-    if ((base_->simplify() == Constant::ZERO) && (power_->simplify() != Constant::ZERO)){
+    if ((base == Constant::ZERO) && (power != Constant::ZERO)){
         return Constant::ZERO;
     }
-    if (power_->simplify() == Constant::ONE){
-        return base_->simplify();
+    if (power == Constant::ONE){
+        return base;
     }
-    if (typeid(*base_) == typeid(Power)){
-        return new Power(static_cast<const Power*>(base_)->get_base(), (new operators::Product({power_, static_cast<const Power*>(base_)->get_power()}))->simplify());
+    if (base->kind() == ExprKind::Power){
+        const Power* inner = static_cast<const Power*>(base);
+        return ExpressionFactory::make_power(inner->get_base(), ExpressionFactory::make_product({power, inner->get_power()})->simplify());
     }
-    return new Power(base_->simplify(), power_->simplify());
+    return ExpressionFactory::make_power(base, power);
 }
 
 const Expression* Power::derivative(const std::string& variable) const{
@@ -47,15 +63,16 @@ const Expression* Power::derivative(const std::string& variable) const{
     } 
     else
    {
-        return (new operators::Product({
-            new Constant(power_->calculate()),
-            new Power(base_, new Constant(power_->calculate() - 1))
-        }))->simplify();
+        // Built from power_ itself so fractional exponents stay exact
+        return ExpressionFactory::make_product({
+            power_,
+            ExpressionFactory::make_power(base_, ExpressionFactory::make_sum({power_, ExpressionFactory::make_constant(-1)}))
+        })->simplify();
     }
 }
 
-const Expression* Power::plug_variable(const std::string& variable) const{
-    return (new Power(base_->plug_variable(variable)->simplify(), power_->plug_variable(variable)))->simplify();
+const Expression* Power::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_power(base_->plug_variable(variable, value)->simplify(), power_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Power::get_input() const{
@@ -73,46 +90,76 @@ std::string Power::to_string() const{
     return s;
 }
 
+bool Power::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Power){
+        return false;
+    }
+    const Power* powExpr = static_cast<const Power*>(&other);
+    return powExpr->hash() == hash() && base_->equals(*powExpr->base_) && power_->equals(*powExpr->power_);
+}
+
+size_t Power::compute_hash() const{
+    return combine_hash(combine_hash(string_hash("Power"), base_->hash()), power_->hash());
+}
+
 
 // Exponent
-Exp::Exp(const Expression* base, const Expression* power){
+Exp::Exp(const Expression* base, const Expression* power) : ElementaryFunction(ExprKind::Exp){
     base_ = base;
     power_ = power;
 }
 
-double Exp::calculate() const{
-    return std::exp(power_->calculate() * std::log(base_->calculate()));
+double Exp::calculate(const EvalContext& context) const{
+    return std::exp(power_->calculate(context) * std::log(base_->calculate(context)));
+}
+
+Dual Exp::calculate_dual(const EvalContext& context, int slot) const{
+    Dual base = base_->calculate_dual(context, slot);
+    Dual power = power_->calculate_dual(context, slot);
+    double log_base = std::log(base.value);
+    double value = std::exp(power.value * log_base);
+    return Dual{value, value * (power.derivative * log_base + power.value * base.derivative / base.value)};
 }
 
-const Expression* Exp::copy() const{
-    return (new Exp(base_, power_))->simplify();
+Interval Exp::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    // Evaluated as exp(power * log(base)), like calculate()
+    Interval base = base_->calculate_interval(context, slot, range);
+    Interval power = power_->calculate_interval(context, slot, range);
+    return Interval::exp(power * Interval::log(base));
 }
 
-const Expression* Exp::simplify() const{
-    if (base_->simplify() == Constant::ONE){
+const Expression* Exp::compute_simplify() const{
+    const Expression* base = base_->simplify();
+    const Expression* power = power_->simplify();
+
+    if (base == Constant::ONE){
         return Constant::ONE;
     }
-    if ((base_->simplify() == Constant::ZERO) && (power_->simplify() != Constant::ZERO)){
+    if ((base == Constant::ZERO) && (power != Constant::ZERO)){
         return Constant::ZERO;
     }
-    if (power_->simplify() == Constant::ONE){
-        return base_->simplify();
+    if (power == Constant::ONE){
+        return base;
     }
-    if (typeid(*base_) == typeid(Power)){
-        return new Exp(static_cast<const Power*>(base_)->get_base()->simplify(), (new operators::Product({power_, static_cast<const Power*>(base_)->get_power()}))->simplify());
+    if (base->kind() == ExprKind::Power){
+        const Power* inner = static_cast<const Power*>(base);
+        return ExpressionFactory::make_exp(inner->get_base()->simplify(), ExpressionFactory::make_product({power, inner->get_power()})->simplify());
     }
-    return new Exp(base_->simplify(), power_->simplify());
+    return ExpressionFactory::make_exp(base, power);
 }
 
 const Expression* Exp::derivative(const std::string& variable) const{
-    return (new operators::Product({
-            new Exp(base_, power_),
-            new Log(Constant::e, base_)
-        }))->simplify();
+    return ExpressionFactory::make_product({
+            ExpressionFactory::make_exp(base_, power_),
+            ExpressionFactory::make_log(Constant::e, base_)
+        })->simplify();
 }
 
-const Expression* Exp::plug_variable(const std::string& variable) const{
-    return (new Exp(base_->plug_variable(variable)->simplify(), power_->plug_variable(variable)))->simplify();
+const Expression* Exp::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_exp(base_->plug_variable(variable, value)->simplify(), power_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Exp::get_input() const{
@@ -125,39 +172,64 @@ std::string Exp::to_string() const{
     return s;
 }
 
+bool Exp::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Exp){
+        return false;
+    }
+    const Exp* expExpr = static_cast<const Exp*>(&other);
+    return expExpr->hash() == hash() && base_->equals(*expExpr->base_) && power_->equals(*expExpr->power_);
+}
+
+size_t Exp::compute_hash() const{
+    return combine_hash(combine_hash(string_hash("Exp"), base_->hash()), power_->hash());
+}
+
 
 // LOgarithm
-Log::Log(const Expression* base, const Expression* arg){
+Log::Log(const Expression* base, const Expression* arg) : ElementaryFunction(ExprKind::Log){
     base_ = base;
     arg_ = arg;
 }
 
-double Log::calculate() const{
-    return std::log(arg_->calculate()) / std::log(base_->calculate());
+double Log::calculate(const EvalContext& context) const{
+    return std::log(arg_->calculate(context)) / std::log(base_->calculate(context));
+}
+
+Dual Log::calculate_dual(const EvalContext& context, int slot) const{
+    Dual base = base_->calculate_dual(context, slot);
+    Dual arg = arg_->calculate_dual(context, slot);
+    Dual log_base{std::log(base.value), base.derivative / base.value};
+    Dual log_arg{std::log(arg.value), arg.derivative / arg.value};
+    return log_arg / log_base;
 }
 
-const Expression* Log::copy() const{
-    return (new Log(base_, arg_))->simplify();
+Interval Log::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    Interval base = base_->calculate_interval(context, slot, range);
+    Interval arg = arg_->calculate_interval(context, slot, range);
+    return Interval::log(arg) / Interval::log(base);
 }
 
-const Expression* Log::simplify() const{
-    if (base_->to_string() == arg_->to_string()){
+const Expression* Log::compute_simplify() const{
+    if (base_->equals(*arg_)){
         return Constant::ONE;
     }
-    return new Log(base_->simplify(), arg_->simplify());
+    return ExpressionFactory::make_log(base_->simplify(), arg_->simplify());
 }
 
 const Expression* Log::derivative(const std::string& variable) const{
-    return (new operators::Fraction(
+    return ExpressionFactory::make_fraction(
         Constant::ONE,
-        new operators::Product({
+        ExpressionFactory::make_product({
             arg_,
-            new Log(Constant::e, base_)
-        })))->simplify();
+            ExpressionFactory::make_log(Constant::e, base_)
+        }))->simplify();
 }
 
-const Expression* Log::plug_variable(const std::string& variable) const{
-    return (new Log(base_->plug_variable(variable), arg_->plug_variable(variable)))->simplify();
+const Expression* Log::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_log(base_->plug_variable(variable, value), arg_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Log::get_input() const{
@@ -175,29 +247,49 @@ std::string Log::to_string() const{
     return s;
 }
 
+bool Log::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Log){
+        return false;
+    }
+    const Log* logExpr = static_cast<const Log*>(&other);
+    return logExpr->hash() == hash() && base_->equals(*logExpr->base_) && arg_->equals(*logExpr->arg_);
+}
+
+size_t Log::compute_hash() const{
+    return combine_hash(combine_hash(string_hash("Log"), base_->hash()), arg_->hash());
+}
+
 // Sin
-Sin::Sin(const Expression* arg){
+Sin::Sin(const Expression* arg) : ElementaryFunction(ExprKind::Sin){
     arg_ = arg;
 }
 
-double Sin::calculate() const{
-    return std::sin(arg_->calculate());
+double Sin::calculate(const EvalContext& context) const{
+    return std::sin(arg_->calculate(context));
+}
+
+Dual Sin::calculate_dual(const EvalContext& context, int slot) const{
+    Dual arg = arg_->calculate_dual(context, slot);
+    return Dual{std::sin(arg.value), std::cos(arg.value) * arg.derivative};
 }
 
-const Expression* Sin::copy() const{
-    return (new Sin(arg_))->simplify();
+Interval Sin::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return Interval::sin(arg_->calculate_interval(context, slot, range));
 }
 
-const Expression* Sin::simplify() const{
-    return new Sin(arg_->simplify());
+const Expression* Sin::compute_simplify() const{
+    return ExpressionFactory::make_sin(arg_->simplify());
 }
 
 const Expression* Sin::derivative(const std::string& variable) const{
-    return (new Cos(arg_))->simplify();
+    return ExpressionFactory::make_cos(arg_)->simplify();
 }
 
-const Expression* Sin::plug_variable(const std::string& variable) const{
-    return (new Sin(arg_->plug_variable(variable)))->simplify();
+const Expression* Sin::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_sin(arg_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Sin::get_input() const{
@@ -208,30 +300,50 @@ std::string Sin::to_string() const{
     return "Sin(" + arg_->to_string() + ")";
 }
 
+bool Sin::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Sin){
+        return false;
+    }
+    const Sin* sinExpr = static_cast<const Sin*>(&other);
+    return sinExpr->hash() == hash() && arg_->equals(*sinExpr->arg_);
+}
+
+size_t Sin::compute_hash() const{
+    return combine_hash(string_hash("Sin"), arg_->hash());
+}
+
 
 // Cos
-Cos::Cos(const Expression* arg){
+Cos::Cos(const Expression* arg) : ElementaryFunction(ExprKind::Cos){
     arg_ = arg;
 }
 
-double Cos::calculate() const{
-    return cos(arg_->calculate());
+double Cos::calculate(const EvalContext& context) const{
+    return cos(arg_->calculate(context));
+}
+
+Dual Cos::calculate_dual(const EvalContext& context, int slot) const{
+    Dual arg = arg_->calculate_dual(context, slot);
+    return Dual{std::cos(arg.value), -std::sin(arg.value) * arg.derivative};
 }
 
-const Expression* Cos::copy() const{
-    return (new Cos(arg_))->simplify();
+Interval Cos::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return Interval::cos(arg_->calculate_interval(context, slot, range));
 }
 
-const Expression* Cos::simplify() const{
-    return new Cos(arg_->simplify());
+const Expression* Cos::compute_simplify() const{
+    return ExpressionFactory::make_cos(arg_->simplify());
 }
 
 const Expression* Cos::derivative(const std::string& variable) const{
-    return (new operators::Product({new Constant(-1), new Sin(arg_)}))->simplify();
+    return ExpressionFactory::make_product({ExpressionFactory::make_constant(-1), ExpressionFactory::make_sin(arg_)})->simplify();
 }
 
-const Expression* Cos::plug_variable(const std::string& variable) const{
-    return (new Cos(arg_->plug_variable(variable)))->simplify();
+const Expression* Cos::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_cos(arg_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Cos::get_input() const{
@@ -242,32 +354,53 @@ std::string Cos::to_string() const{
     return "Cos(" + arg_->to_string() + ")";
 }
 
+bool Cos::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Cos){
+        return false;
+    }
+    const Cos* cosExpr = static_cast<const Cos*>(&other);
+    return cosExpr->hash() == hash() && arg_->equals(*cosExpr->arg_);
+}
+
+size_t Cos::compute_hash() const{
+    return combine_hash(string_hash("Cos"), arg_->hash());
+}
+
 
 // Tan
-Tan::Tan(const Expression* arg){
+Tan::Tan(const Expression* arg) : ElementaryFunction(ExprKind::Tan){
     arg_ = arg;
 }
 
-double Tan::calculate() const{
-    return tan(arg_->calculate());
+double Tan::calculate(const EvalContext& context) const{
+    return tan(arg_->calculate(context));
 }
 
-const Expression* Tan::copy() const{
-    return (new Tan(arg_))->simplify();
+Dual Tan::calculate_dual(const EvalContext& context, int slot) const{
+    Dual arg = arg_->calculate_dual(context, slot);
+    double c = std::cos(arg.value);
+    return Dual{std::tan(arg.value), arg.derivative / (c * c)};
 }
 
-const Expression* Tan::simplify() const{
-    return new Tan(arg_->simplify());
+Interval Tan::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return Interval::tan(arg_->calculate_interval(context, slot, range));
+}
+
+const Expression* Tan::compute_simplify() const{
+    return ExpressionFactory::make_tan(arg_->simplify());
 }
 
 const Expression* Tan::derivative(const std::string& variable) const{
-    return (new operators::Fraction(
+    return ExpressionFactory::make_fraction(
         Constant::ONE,
-        new Power(new Cos(arg_), new Constant(2))))->simplify();
+        ExpressionFactory::make_power(ExpressionFactory::make_cos(arg_), ExpressionFactory::make_constant(2)))->simplify();
 }
 
-const Expression* Tan::plug_variable(const std::string& variable) const{
-    return (new Tan(arg_->plug_variable(variable)))->simplify();
+const Expression* Tan::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_tan(arg_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Tan::get_input() const{
@@ -278,35 +411,56 @@ std::string Tan::to_string() const{
     return "tan(" + arg_->to_string() + ")";
 }
 
+bool Tan::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Tan){
+        return false;
+    }
+    const Tan* tanExpr = static_cast<const Tan*>(&other);
+    return tanExpr->hash() == hash() && arg_->equals(*tanExpr->arg_);
+}
+
+size_t Tan::compute_hash() const{
+    return combine_hash(string_hash("Tan"), arg_->hash());
+}
+
 
 // Cot
-Cot::Cot(const Expression* arg){
+Cot::Cot(const Expression* arg) : ElementaryFunction(ExprKind::Cot){
     arg_ = arg;
 }
 
-double Cot::calculate() const{
-    return 1 / tan(arg_->calculate());
+double Cot::calculate(const EvalContext& context) const{
+    return 1 / tan(arg_->calculate(context));
 }
 
-const Expression* Cot::copy() const{
-    return (new Cot(arg_))->simplify();
+Dual Cot::calculate_dual(const EvalContext& context, int slot) const{
+    Dual arg = arg_->calculate_dual(context, slot);
+    double s = std::sin(arg.value);
+    return Dual{1 / std::tan(arg.value), -arg.derivative / (s * s)};
 }
 
-const Expression* Cot::simplify() const{
-    return new Cot(arg_->simplify());
+Interval Cot::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return Interval::cot(arg_->calculate_interval(context, slot, range));
+}
+
+const Expression* Cot::compute_simplify() const{
+    return ExpressionFactory::make_cot(arg_->simplify());
 }
 
 const Expression* Cot::derivative(const std::string& variable) const{
-    return (new operators::Product({
-        new Constant(-1),
-        new operators::Fraction(
+    return ExpressionFactory::make_product({
+        ExpressionFactory::make_constant(-1),
+        ExpressionFactory::make_fraction(
             Constant::ONE,
-            new Power(new Sin(arg_), new Constant(2)))
-    }))->simplify();
+            ExpressionFactory::make_power(ExpressionFactory::make_sin(arg_), ExpressionFactory::make_constant(2)))
+    })->simplify();
 }
 
-const Expression* Cot::plug_variable(const std::string& variable) const{
-    return (new Cot(arg_->plug_variable(variable)))->simplify();
+const Expression* Cot::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_cot(arg_->plug_variable(variable, value))->simplify();
 }
 
 const Expression* Cot::get_input() const{
@@ -316,4 +470,19 @@ const Expression* Cot::get_input() const{
 std::string Cot::to_string() const{
     return "cot(" + arg_->to_string() + ")";
 }
+
+bool Cot::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Cot){
+        return false;
+    }
+    const Cot* cotExpr = static_cast<const Cot*>(&other);
+    return cotExpr->hash() == hash() && arg_->equals(*cotExpr->arg_);
+}
+
+size_t Cot::compute_hash() const{
+    return combine_hash(string_hash("Cot"), arg_->hash());
+}
 };
\ No newline at end of file
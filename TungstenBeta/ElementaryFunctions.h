@@ -9,13 +9,15 @@ namespace ElementaryFunctions{
         const Expression* input_;
 
     public:
-        ElementaryFunction();
+        explicit ElementaryFunction(ExprKind kind);
         ~ElementaryFunction();
 
         virtual const Expression* derivative(const std::string& variable) const = 0;
         virtual const Expression* get_input() const = 0;
 
-        const Expression* complex_derivative(const std::string& variable) const override;
+    protected:
+        // Chain rule: derivative() times the derivative of get_input()
+        const Expression* compute_derivative(const std::string& variable) const override;
     };
 
 
@@ -24,6 +26,9 @@ namespace ElementaryFunctions{
         const Expression* base_;
         const Expression* power_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Power(const Expression* base, const Expression* power);
         const Expression* get_base() const { return base_; };
@@ -31,14 +36,15 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
 
@@ -47,6 +53,9 @@ namespace ElementaryFunctions{
         const Expression* power_;
         const Expression* base_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Exp(const Expression* base, const Expression* power);
         const Expression* get_base() const { return base_; };
@@ -54,14 +63,15 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
 
@@ -70,6 +80,9 @@ namespace ElementaryFunctions{
         const Expression* base_;
         const Expression* arg_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Log(const Expression* base, const Expression* arg);
         const Expression* get_base() const { return base_; };
@@ -78,20 +91,24 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
     class Sin : public ElementaryFunction{
     private:
         const Expression* arg_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Sin(const Expression* arg);
         const Expression* get_arg() const { return arg_; };
@@ -99,20 +116,24 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
     class Cos : public ElementaryFunction{
     private:
         const Expression* arg_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Cos(const Expression* arg);
         const Expression* get_arg() const { return arg_; };
@@ -120,20 +141,24 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
     class Tan : public ElementaryFunction{
     private:
         const Expression* arg_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Tan(const Expression* arg);
         const Expression* get_arg() const { return arg_; };
@@ -141,20 +166,24 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        double calculate() const override;
-        const Expression* plug_variable(const std::string& variable) const override;
-        const Expression* copy() const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
     class Cot : public ElementaryFunction{
     private:
         const Expression* arg_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+
     public:
         Cot(const Expression* arg);
         const Expression* get_arg() const { return arg_; };
@@ -162,14 +191,15 @@ namespace ElementaryFunctions{
 
         // elementary function
         const Expression* derivative(const std::string& variable) const override;
-        const Expression* simplify() const override;
         const Expression* get_input() const override;
 
         // expression
-        const Expression* plug_variable(const std::string& variable) const override;
-        double calculate() const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 };
 
@@ -0,0 +1,56 @@
+#include "EvalContext.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace{
+    struct SymbolTable{
+        std::mutex mutex;
+        std::unordered_map<std::string, int> slots;
+        std::vector<std::string> names;
+    };
+
+    SymbolTable& symbols(){
+        static SymbolTable* table = new SymbolTable;
+        return *table;
+    }
+}
+
+int EvalContext::slot_of(const std::string& name){
+    SymbolTable& table = symbols();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    auto it = table.slots.find(name);
+    if (it != table.slots.end()){
+        return it->second;
+    }
+    int slot = static_cast<int>(table.names.size());
+    table.names.push_back(name);
+    table.slots.emplace(name, slot);
+    return slot;
+}
+
+std::string EvalContext::name_of(int slot){
+    SymbolTable& table = symbols();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return table.names.at(slot);
+}
+
+void EvalContext::set(int slot, double value){
+    if (slot >= static_cast<int>(values_.size())){
+        values_.resize(slot + 1, 0);
+        bound_.resize(slot + 1, 0);
+    }
+    values_[slot] = value;
+    bound_[slot] = 1;
+}
+
+void EvalContext::set(const std::string& name, double value){
+    set(slot_of(name), value);
+}
+
+void EvalContext::unset(int slot){
+    if (slot < static_cast<int>(bound_.size())){
+        bound_[slot] = 0;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef EVAL_CONTEXT_H
+#define EVAL_CONTEXT_H
+
+#include <string>
+#include <vector>
+
+// Values of the variables for one evaluation. Every variable name is given
+// a dense slot once, when its Variable node is built, so evaluation indexes
+// an array instead of hashing strings and nothing is allocated per call.
+// Contexts are plain values: each thread or solver owns its own.
+class EvalContext{
+public:
+    // Slot of a variable name, assigned on first use (thread-safe)
+    static int slot_of(const std::string& name);
+    static std::string name_of(int slot);
+
+    void set(int slot, double value);
+    void set(const std::string& name, double value);
+    void unset(int slot);
+
+    // Unbound variables evaluate to 0
+    double get(int slot) const{
+        return (slot < static_cast<int>(values_.size()) && bound_[slot]) ? values_[slot] : 0;
+    }
+    bool is_bound(int slot) const{
+        return slot < static_cast<int>(bound_.size()) && bound_[slot];
+    }
+
+private:
+    std::vector<double> values_;
+    std::vector<char> bound_;
+};
+
+#endif // EVAL_CONTEXT_H
@@ -1 +1,79 @@
-#include "Expression.h"
\ No newline at end of file
+#include "Expression.h"
+#include "ExpressionArena.h"
+
+double Expression::calculate() const{
+    static const EvalContext empty;
+    return calculate(empty);
+}
+
+Interval Expression::calculate_interval(const std::string& variable, double lo, double hi) const{
+    static const EvalContext empty;
+    return calculate_interval(empty, EvalContext::slot_of(variable), Interval{lo, hi});
+}
+
+const Expression* Expression::complex_derivative(const std::string& variable) const{
+    ExpressionArena& arena = ExpressionArena::current();
+    int slot = EvalContext::slot_of(variable);
+    if (const Expression* cached = arena.find_derivative(this, slot)){
+        return cached;
+    }
+    return arena.insert_derivative(this, slot, compute_derivative(variable));
+}
+
+const Expression* Expression::simplify() const{
+    if (normalized_.load(std::memory_order_acquire)){
+        return this;
+    }
+    if (const Expression* cached = simplified_.load(std::memory_order_acquire)){
+        return cached;
+    }
+
+    const Expression* result = compute_simplify();
+    result->normalized_.store(true, std::memory_order_release);
+    // The result may belong to the current arena; only a node of that same
+    // arena is guaranteed not to outlive it
+    if (result != this && arena_ == &ExpressionArena::current()){
+        simplified_.store(result, std::memory_order_release);
+    }
+    return result;
+}
+
+size_t Expression::hash() const{
+    size_t h = hash_.load(std::memory_order_relaxed);
+    if (h == 0){
+        h = compute_hash();
+        // 0 marks a hash that has not been computed yet
+        if (h == 0){
+            h = 1;
+        }
+        hash_.store(h, std::memory_order_relaxed);
+    }
+    return h;
+}
+
+size_t Expression::combine_hash(size_t seed, size_t value){
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t Expression::string_hash(const std::string& s){
+    // FNV-1a, so hashes do not depend on the standard library implementation
+    unsigned long long h = 14695981039346656037ULL;
+    for (unsigned char c : s){
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+bool canonical_less(const Expression* lhs, const Expression* rhs){
+    if (lhs == rhs){
+        return false;
+    }
+    if (lhs->hash() != rhs->hash()){
+        return lhs->hash() < rhs->hash();
+    }
+    if (lhs->equals(*rhs)){
+        return false;
+    }
+    return lhs->to_string() < rhs->to_string();
+}
@@ -8,21 +8,93 @@
 #include <cmath>
 #include <numeric>
 #include <unordered_map>
+#include <atomic>
+
+#include "EvalContext.h"
+#include "Dual.h"
+#include "Interval.h"
+
+class ExpressionArena;
+
+// Node kind stored in every expression, used instead of RTTI for dispatch
+enum class ExprKind{
+    Constant, Variable, Sum, Product, Fraction,
+    Power, Exp, Log, Sin, Cos, Tan, Cot
+};
 
 class Expression{
 public:
-    virtual double calculate() const = 0;
-    virtual const Expression* complex_derivative(const std::string& variable) const = 0;
-    virtual const Expression* copy() const = 0;
-    virtual const Expression* plug_variable(const std::string& variable) const = 0;
+    explicit Expression(ExprKind kind) : kind_(kind) {}
+    ExprKind kind() const { return kind_; }
+
+    virtual double calculate(const EvalContext& context) const = 0;
+    // Evaluates with no variables bound, for constant subexpressions
+    double calculate() const;
+    // Value and derivative with respect to the variable in the given slot
+    virtual Dual calculate_dual(const EvalContext& context, int slot) const = 0;
+    // Guaranteed enclosure of the values taken while the variable in the
+    // given slot ranges over range; other variables are read from context
+    virtual Interval calculate_interval(const EvalContext& context, int slot, Interval range) const = 0;
+    // Range of a one-variable expression for variable in [lo, hi]
+    Interval calculate_interval(const std::string& variable, double lo, double hi) const;
+    // Derivative with respect to variable, memoized per (node, variable) in
+    // the current ExpressionArena so shared subtrees are differentiated once
+    const Expression* complex_derivative(const std::string& variable) const;
+    // Nodes are immutable and interned, so a copy is the node itself
+    const Expression* copy() const { return this; }
+    // Substitutes value for every occurrence of the variable
+    virtual const Expression* plug_variable(const std::string& variable, const Expression* value) const = 0;
     virtual std::string to_string() const = 0;
-    virtual const Expression* simplify() const = 0;
+    // Greedy simplification. The result is cached on the node and marked
+    // normalized, so simplifying it (or this node) again is O(1).
+    const Expression* simplify() const;
+    // Set when Polynomial gave up expanding this subtree (too many terms or
+    // coefficients past 64 bits); sums holding it do not try again
+    bool not_polynomial() const { return not_polynomial_.load(std::memory_order_relaxed); }
+    void mark_not_polynomial() const { not_polynomial_.store(true, std::memory_order_relaxed); }
     virtual ~Expression() = default;
 
+    // Structural hash, computed once per node and stable between runs
+    size_t hash() const;
+    // Structural equality; interned nodes are equal only to themselves
+    virtual bool equals(const Expression& other) const = 0;
+
     friend const Expression* operator+(const Expression& lhs, const Expression& rhs);
     friend const Expression* operator-(const Expression& lhs, const Expression& rhs);
     friend const Expression* operator*(const Expression& lhs, const Expression& rhs);
     friend const Expression* operator/(const Expression& lhs, const Expression& rhs);
+
+protected:
+    virtual size_t compute_hash() const = 0;
+    virtual const Expression* compute_derivative(const std::string& variable) const = 0;
+    // Children may be simplified with simplify(), which is cheap for them
+    virtual const Expression* compute_simplify() const = 0;
+    static size_t combine_hash(size_t seed, size_t value);
+    static size_t string_hash(const std::string& s);
+
+private:
+    friend class ExpressionArena;
+
+    const ExprKind kind_;
+    mutable std::atomic<size_t> hash_{0};
+    // simplify() returns the node itself
+    mutable std::atomic<bool> normalized_{false};
+    mutable std::atomic<const Expression*> simplified_{nullptr};
+    mutable std::atomic<bool> not_polynomial_{false};
+    // Arena that owns the node, null for nodes created outside of arenas
+    const ExpressionArena* arena_ = nullptr;
+};
+
+// Functors for hash containers keyed by expression structure
+struct ExpressionHash{
+    size_t operator()(const Expression* expr) const { return expr->hash(); }
 };
 
+struct ExpressionEqual{
+    bool operator()(const Expression* lhs, const Expression* rhs) const { return lhs->equals(*rhs); }
+};
+
+// Canonical order of terms and factors used by the simplifiers
+bool canonical_less(const Expression* lhs, const Expression* rhs);
+
 #endif // EXPRESSION_H
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "ExpressionArena.h"
+
+thread_local ExpressionArena* ExpressionArena::current_ = nullptr;
+
+ExpressionArena::ExpressionArena(ExpressionArena* parent){
+    parent_ = (parent == this) ? nullptr : parent;
+}
+
+ExpressionArena::~ExpressionArena(){
+    release();
+}
+
+ExpressionArena& ExpressionArena::global(){
+    static ExpressionArena* instance = new ExpressionArena(nullptr);
+    return *instance;
+}
+
+ExpressionArena& ExpressionArena::current(){
+    if (current_ != nullptr){
+        return *current_;
+    }
+    return global();
+}
+
+ExpressionArena::Scope::Scope(ExpressionArena& arena){
+    previous_ = current_;
+    current_ = &arena;
+}
+
+ExpressionArena::Scope::~Scope(){
+    current_ = previous_;
+}
+
+const Expression* ExpressionArena::find(const ExpressionFactory::NodeKey& key){
+    for (ExpressionArena* arena = this; arena != nullptr; arena = arena->parent_){
+        std::lock_guard<std::mutex> lock(arena->mutex_);
+        auto it = arena->nodes_.find(key);
+        if (it != arena->nodes_.end()){
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+const Expression* ExpressionArena::insert(ExpressionFactory::NodeKey&& key, const Expression* node){
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Another thread may have interned the same key in the meantime; the
+    // duplicate stays owned by the arena and is simply never handed out.
+    return nodes_.emplace(std::move(key), node).first->second;
+}
+
+const Expression* ExpressionArena::find_derivative(const Expression* node, int slot){
+    for (ExpressionArena* arena = this; arena != nullptr; arena = arena->parent_){
+        std::lock_guard<std::mutex> lock(arena->mutex_);
+        auto it = arena->derivatives_.find({node, slot});
+        if (it != arena->derivatives_.end()){
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+const Expression* ExpressionArena::insert_derivative(const Expression* node, int slot, const Expression* derivative){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return derivatives_.emplace(std::make_pair(node, slot), derivative).first->second;
+}
+
+void* ExpressionArena::allocate(size_t size, size_t alignment){
+    size_t offset = reinterpret_cast<uintptr_t>(cursor_) % alignment;
+    char* start = cursor_ + (offset ? alignment - offset : 0);
+
+    if (cursor_ == nullptr || start + size > end_){
+        char* block = static_cast<char*>(::operator new(BLOCK_SIZE));
+        blocks_.push_back(block);
+        start = block;
+        end_ = block + BLOCK_SIZE;
+    }
+    cursor_ = start + size;
+    bytes_used_ += size;
+    return start;
+}
+
+void ExpressionArena::release(){
+    for (auto it = constructed_.rbegin(); it != constructed_.rend(); ++it){
+        (*it)->~Expression();
+    }
+    for (char* block : blocks_){
+        ::operator delete(block);
+    }
+    constructed_.clear();
+    blocks_.clear();
+    nodes_.clear();
+    derivatives_.clear();
+    cursor_ = nullptr;
+    end_ = nullptr;
+    bytes_used_ = 0;
+}
+
+void ExpressionArena::reset(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    release();
+}
+
+size_t ExpressionArena::node_count(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_.size();
+}
+
+size_t ExpressionArena::bytes_used(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_used_;
+}
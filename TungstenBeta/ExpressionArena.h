@@ -0,0 +1,87 @@
+#ifndef EXPRESSION_ARENA_H
+#define EXPRESSION_ARENA_H
+
+#include "Expression.h"
+#include "ExpressionFactory.h"
+
+#include <mutex>
+
+// Owns every node created while it is the current arena of a thread. Nodes
+// are placed into large blocks by bumping a pointer and are all released
+// together by reset() or the destructor. An arena also holds the intern
+// table for its nodes; lookups fall through to the parent arena, so a node
+// built in a short-lived arena may reuse (but never be reused by) longer-lived
+// ones. Derivatives are memoized the same way. Nodes created outside of any Scope go to the process-wide global arena.
+class ExpressionArena{
+public:
+    explicit ExpressionArena(ExpressionArena* parent = &ExpressionArena::global());
+    ~ExpressionArena();
+
+    ExpressionArena(const ExpressionArena&) = delete;
+    ExpressionArena& operator=(const ExpressionArena&) = delete;
+
+    // Makes an arena current for the calling thread until the scope ends
+    class Scope{
+    public:
+        explicit Scope(ExpressionArena& arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ExpressionArena* previous_;
+    };
+
+    static ExpressionArena& global();
+    static ExpressionArena& current();
+
+    const Expression* find(const ExpressionFactory::NodeKey& key);
+    const Expression* insert(ExpressionFactory::NodeKey&& key, const Expression* node);
+
+    // Memoized derivatives, keyed by node and EvalContext slot of the variable
+    const Expression* find_derivative(const Expression* node, int slot);
+    const Expression* insert_derivative(const Expression* node, int slot, const Expression* derivative);
+
+    template <typename T, typename... Args>
+    const T* construct(Args&&... args){
+        std::lock_guard<std::mutex> lock(mutex_);
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* node = new (memory) T(std::forward<Args>(args)...);
+        static_cast<Expression*>(node)->arena_ = this;
+        constructed_.push_back(node);
+        return node;
+    }
+
+    // Destroys all nodes of this arena; pointers into it become invalid
+    void reset();
+
+    size_t node_count();
+    size_t bytes_used();
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct DerivativeKeyHash{
+        size_t operator()(const std::pair<const Expression*, int>& key) const{
+            return std::hash<const Expression*>()(key.first) * 31 + key.second;
+        }
+    };
+
+    void* allocate(size_t size, size_t alignment);
+    void release();
+
+    ExpressionArena* parent_;
+    std::mutex mutex_;
+    std::unordered_map<ExpressionFactory::NodeKey, const Expression*, ExpressionFactory::NodeKeyHash> nodes_;
+    std::unordered_map<std::pair<const Expression*, int>, const Expression*, DerivativeKeyHash> derivatives_;
+    std::vector<const Expression*> constructed_;
+    std::vector<char*> blocks_;
+    char* cursor_ = nullptr;
+    char* end_ = nullptr;
+    size_t bytes_used_ = 0;
+
+    static thread_local ExpressionArena* current_;
+};
+
+#endif // EXPRESSION_ARENA_H
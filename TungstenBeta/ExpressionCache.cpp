@@ -0,0 +1,277 @@
+#include "ExpressionCache.h"
+#include "Parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace{
+    const char MAGIC[4] = {'T', 'N', 'G', 'C'};
+    const uint32_t ENTRY_VERSION = 1;
+    const char* ENTRY_SUFFIX = ".tngc";
+    const char* TEMPORARY_PREFIX = ".tmp.";
+    // Temporary files this old were left by a writer that died
+    const time_t STALE_SECONDS = 3600;
+
+    // Followed by the key, padding to a multiple of 8 and the image
+    struct EntryHeader{
+        char magic[4];
+        uint32_t version;
+        uint32_t key_length;
+        uint32_t reserved;
+    };
+
+    size_t image_offset(size_t key_length){
+        return (sizeof(EntryHeader) + key_length + 7) & ~size_t(7);
+    }
+
+    bool ends_with(const std::string& text, const char* suffix){
+        size_t length = std::strlen(suffix);
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+
+    bool write_all(int fd, const std::string& data){
+        size_t written = 0;
+        while (written < data.size()){
+            ssize_t result = ::write(fd, data.data() + written, data.size() - written);
+            if (result < 0 && errno == EINTR){
+                continue;
+            }
+            if (result <= 0){
+                return false;
+            }
+            written += static_cast<size_t>(result);
+        }
+        return true;
+    }
+
+    bool read_all(int fd, char* data, size_t size, off_t offset){
+        while (size != 0){
+            ssize_t result = pread(fd, data, size, offset);
+            if (result < 0 && errno == EINTR){
+                continue;
+            }
+            if (result <= 0){
+                return false;
+            }
+            data += result;
+            size -= static_cast<size_t>(result);
+            offset += result;
+        }
+        return true;
+    }
+}
+
+ExpressionCache::ExpressionCache(const std::string& directory, size_t max_bytes)
+        : directory_(directory), max_bytes_(max_bytes) {
+    mkdir(directory_.c_str(), 0755);
+    evict();
+}
+
+std::string ExpressionCache::normalize(std::string_view text){
+    std::string result;
+    bool space = false;
+    for (char c : text){
+        if (std::isspace(static_cast<unsigned char>(c))){
+            space = !result.empty();
+            continue;
+        }
+        if (space){
+            result += ' ';
+            space = false;
+        }
+        result += c;
+    }
+    return result;
+}
+
+const Expression* ExpressionCache::simplified(std::string_view text){
+    std::string input = normalize(text);
+    return lookup("simplify\n\n" + input, [&](){
+        return Parser::parse(input)->simplify();
+    });
+}
+
+const Expression* ExpressionCache::derivative(std::string_view text, const std::string& variable){
+    std::string input = normalize(text);
+    return lookup("derivative\n" + variable + "\n" + input, [&](){
+        return Parser::parse(input)->complex_derivative(variable)->simplify();
+    });
+}
+
+MappedExpression ExpressionCache::tape(std::string_view text){
+    std::string input = normalize(text);
+    std::string key = "simplify\n\n" + input;
+    std::string path = path_of(key);
+    size_t offset = find(path, key);
+    if (offset != 0){
+        try{
+            MappedExpression image(path, offset);
+            ++hits_;
+            return image;
+        } catch (const std::exception&){
+        }
+    }
+    ++misses_;
+    if (!store(path, key, Parser::parse(input)->simplify())){
+        throw std::runtime_error("ExpressionCache: cannot write " + path);
+    }
+    return MappedExpression(path, image_offset(key.size()));
+}
+
+const Expression* ExpressionCache::lookup(const std::string& key, const std::function<const Expression*()>& compute){
+    std::string path = path_of(key);
+    size_t offset = find(path, key);
+    if (offset != 0){
+        // A damaged entry is a miss and gets replaced
+        try{
+            const Expression* result = MappedExpression(path, offset).to_expression();
+            ++hits_;
+            return result;
+        } catch (const std::exception&){
+        }
+    }
+    ++misses_;
+    const Expression* result = compute();
+    store(path, key, result);
+    return result;
+}
+
+// FNV-1a of the key; find() compares the stored key, so collisions only
+// cost a miss
+std::string ExpressionCache::path_of(const std::string& key) const{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key){
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return directory_ + "/" + name + ENTRY_SUFFIX;
+}
+
+size_t ExpressionCache::find(const std::string& path, const std::string& key){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        return 0;
+    }
+    EntryHeader header;
+    std::string stored;
+    bool found = read_all(fd, reinterpret_cast<char*>(&header), sizeof(header), 0) &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == ENTRY_VERSION &&
+                 header.key_length == key.size();
+    if (found){
+        stored.resize(key.size());
+        found = read_all(fd, &stored[0], stored.size(), sizeof(header)) && stored == key;
+    }
+    if (found){
+        // Marks the entry as recently used
+        futimens(fd, nullptr);
+    }
+    close(fd);
+    return found ? image_offset(key.size()) : 0;
+}
+
+bool ExpressionCache::store(const std::string& path, const std::string& key, const Expression* expr){
+    EntryHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = ENTRY_VERSION;
+    header.key_length = static_cast<uint32_t>(key.size());
+    std::string entry(image_offset(key.size()), '\0');
+    std::memcpy(&entry[0], &header, sizeof(header));
+    std::memcpy(&entry[sizeof(header)], key.data(), key.size());
+    entry += MappedExpression::serialize(expr);
+
+    // Readers see either the old entry or the complete new one
+    std::string temporary = directory_ + "/" + TEMPORARY_PREFIX + std::to_string(getpid()) + "." +
+                            std::to_string(temporaries_++);
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0){
+        return false;
+    }
+    bool written = write_all(fd, entry);
+    written = close(fd) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0){
+        unlink(temporary.c_str());
+        return false;
+    }
+    if ((size_ += entry.size()) > max_bytes_){
+        evict();
+    }
+    return true;
+}
+
+void ExpressionCache::evict(){
+    std::lock_guard<std::mutex> guard(mutex_);
+    // The mutex serializes the threads of this process, the flock the
+    // processes sharing the directory
+    int lock = open((directory_ + "/lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (lock < 0){
+        return;
+    }
+    if (flock(lock, LOCK_EX) != 0){
+        close(lock);
+        return;
+    }
+
+    struct Entry{
+        std::string path;
+        size_t size;
+        struct timespec used;
+    };
+    std::vector<Entry> entries;
+    size_t total = 0;
+    time_t now = std::time(nullptr);
+    if (DIR* directory = opendir(directory_.c_str())){
+        while (dirent* item = readdir(directory)){
+            std::string name = item->d_name;
+            bool temporary = name.compare(0, std::strlen(TEMPORARY_PREFIX), TEMPORARY_PREFIX) == 0;
+            if (!temporary && !ends_with(name, ENTRY_SUFFIX)){
+                continue;
+            }
+            std::string path = directory_ + "/" + name;
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0){
+                continue;
+            }
+            if (temporary){
+                if (now - info.st_mtim.tv_sec > STALE_SECONDS){
+                    unlink(path.c_str());
+                }
+                continue;
+            }
+            entries.push_back(Entry{path, static_cast<size_t>(info.st_size), info.st_mtim});
+            total += static_cast<size_t>(info.st_size);
+        }
+        closedir(directory);
+    }
+
+    // Down to three quarters of the bound, so the next few stores do not
+    // scan the directory again
+    if (total > max_bytes_){
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+            return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+        });
+        size_t target = max_bytes_ / 4 * 3;
+        for (const Entry& entry : entries){
+            if (total <= target){
+                break;
+            }
+            if (unlink(entry.path.c_str()) == 0 || errno == ENOENT){
+                total -= entry.size;
+            }
+        }
+    }
+    size_ = total;
+
+    flock(lock, LOCK_UN);
+    close(lock);
+}
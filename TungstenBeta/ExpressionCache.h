@@ -0,0 +1,71 @@
+#ifndef EXPRESSION_CACHE_H
+#define EXPRESSION_CACHE_H
+
+#include "Expression.h"
+#include "MappedExpression.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string_view>
+
+// Results of parsing and simplifying kept on disk across runs. An entry is
+// named by a hash of the operation, the variable and the input with its
+// whitespace normalized; it holds that key, to tell collisions apart, and
+// the result as a MappedExpression image. Entries are written to a
+// temporary file and renamed into place, so any number of threads and
+// processes may share a directory without locks on lookups. Hits refresh
+// the modification time, and once the directory grows past its bound the
+// least recently used entries are deleted under an flock. Each process
+// only counts its own writes between scans, so with several writers the
+// directory can briefly exceed the bound.
+//
+// The cache is best effort: a directory that cannot be written only makes
+// every lookup a miss. Inputs that do not parse throw ParseError and are
+// not stored.
+class ExpressionCache{
+public:
+    static const size_t DEFAULT_MAX_BYTES = size_t(256) << 20;
+
+    // Creates the directory if needed
+    explicit ExpressionCache(const std::string& directory, size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    ExpressionCache(const ExpressionCache&) = delete;
+    ExpressionCache& operator=(const ExpressionCache&) = delete;
+
+    // The parsed and simplified text, built in the current arena
+    const Expression* simplified(std::string_view text);
+    // The simplified derivative of the text, built in the current arena
+    const Expression* derivative(std::string_view text, const std::string& variable);
+    // The simplified text mapped for evaluation, without building any nodes.
+    // Throws std::runtime_error if the entry cannot be written.
+    MappedExpression tape(std::string_view text);
+
+    // Deletes least recently used entries until the directory fits its bound
+    void evict();
+
+    size_t hits() const { return hits_.load(); }
+    size_t misses() const { return misses_.load(); }
+
+    // Trimmed, with every run of whitespace collapsed to one space
+    static std::string normalize(std::string_view text);
+
+private:
+    std::string directory_;
+    size_t max_bytes_;
+    std::atomic<size_t> hits_{0};
+    std::atomic<size_t> misses_{0};
+    // Size of the directory at the last scan plus what was stored since
+    std::atomic<size_t> size_{0};
+    // Numbers the temporary files of this process
+    std::atomic<size_t> temporaries_{0};
+    std::mutex mutex_;
+
+    std::string path_of(const std::string& key) const;
+    // Offset of the image in the entry at path, or 0 if it does not hold key
+    size_t find(const std::string& path, const std::string& key);
+    bool store(const std::string& path, const std::string& key, const Expression* expr);
+    const Expression* lookup(const std::string& key, const std::function<const Expression*()>& compute);
+};
+
+#endif // EXPRESSION_CACHE_H
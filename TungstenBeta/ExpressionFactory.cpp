@@ -0,0 +1,98 @@
+#include "ExpressionFactory.h"
+#include "ExpressionArena.h"
+
+#include "Constant.h"
+#include "Variable.h"
+#include "operators.h"
+#include "ElementaryFunctions.h"
+
+namespace{
+    template <typename T, typename... Args>
+    const Expression* intern(ExpressionFactory::NodeKey&& key, Args&&... args){
+        ExpressionArena& arena = ExpressionArena::current();
+
+        const Expression* node = arena.find(key);
+        if (node != nullptr){
+            return node;
+        }
+        return arena.insert(std::move(key), arena.construct<T>(std::forward<Args>(args)...));
+    }
+}
+
+size_t ExpressionFactory::NodeKeyHash::operator()(const NodeKey& key) const{
+    size_t h = std::hash<int>()(static_cast<int>(key.kind));
+    h ^= std::hash<long long>()(key.value) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= std::hash<std::string>()(key.name) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    for (const Expression* child : key.children){
+        h ^= std::hash<const Expression*>()(child) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+const Expression* ExpressionFactory::make_constant(long long value){
+    if (value == 0){
+        return Constant::ZERO;
+    }
+    if (value == 1){
+        return Constant::ONE;
+    }
+    return intern<Constant>({ExprKind::Constant, value, "", {}}, value);
+}
+
+const Expression* ExpressionFactory::make_constant(const Rational& value){
+    if (value.is_small_integer()){
+        return make_constant(value.numerator());
+    }
+    // Fractions and big integers are keyed by their exact decimal form
+    return intern<Constant>({ExprKind::Constant, 0, value.to_string(), {}}, value);
+}
+
+const Expression* ExpressionFactory::make_variable(const std::string& name){
+    return intern<Variable>({ExprKind::Variable, 0, name, {}}, name);
+}
+
+const Expression* ExpressionFactory::make_sum(std::vector<const Expression*>&& terms){
+    std::vector<const Expression*> children = terms;
+    return intern<operators::Sum>({ExprKind::Sum, 0, "", std::move(children)}, std::move(terms));
+}
+
+const Expression* ExpressionFactory::make_product(std::vector<const Expression*>&& factors){
+    std::vector<const Expression*> children = factors;
+    return intern<operators::Product>({ExprKind::Product, 0, "", std::move(children)}, std::move(factors));
+}
+
+const Expression* ExpressionFactory::make_fraction(const Expression* dividend, const Expression* divisor){
+    return intern<operators::Fraction>({ExprKind::Fraction, 0, "", {dividend, divisor}}, dividend, divisor);
+}
+
+const Expression* ExpressionFactory::make_power(const Expression* base, const Expression* power){
+    return intern<ElementaryFunctions::Power>({ExprKind::Power, 0, "", {base, power}}, base, power);
+}
+
+const Expression* ExpressionFactory::make_exp(const Expression* base, const Expression* power){
+    return intern<ElementaryFunctions::Exp>({ExprKind::Exp, 0, "", {base, power}}, base, power);
+}
+
+const Expression* ExpressionFactory::make_log(const Expression* base, const Expression* arg){
+    return intern<ElementaryFunctions::Log>({ExprKind::Log, 0, "", {base, arg}}, base, arg);
+}
+
+const Expression* ExpressionFactory::make_sin(const Expression* arg){
+    return intern<ElementaryFunctions::Sin>({ExprKind::Sin, 0, "", {arg}}, arg);
+}
+
+const Expression* ExpressionFactory::make_cos(const Expression* arg){
+    return intern<ElementaryFunctions::Cos>({ExprKind::Cos, 0, "", {arg}}, arg);
+}
+
+const Expression* ExpressionFactory::make_tan(const Expression* arg){
+    return intern<ElementaryFunctions::Tan>({ExprKind::Tan, 0, "", {arg}}, arg);
+}
+
+const Expression* ExpressionFactory::make_cot(const Expression* arg){
+    return intern<ElementaryFunctions::Cot>({ExprKind::Cot, 0, "", {arg}}, arg);
+}
+
+size_t ExpressionFactory::node_count(){
+    return ExpressionArena::current().node_count();
+}
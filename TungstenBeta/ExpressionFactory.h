@@ -0,0 +1,50 @@
+#ifndef EXPRESSION_FACTORY_H
+#define EXPRESSION_FACTORY_H
+
+#include "Expression.h"
+#include "Rational.h"
+
+// All expression nodes are created through the factory. Structurally identical
+// nodes are interned (hash-consing), so equal subtrees are the same object and
+// can be compared by pointer. Nodes are owned by the current ExpressionArena
+// and must not be deleted by callers.
+class ExpressionFactory{
+public:
+    // Children are already interned, so a node is identified by its kind,
+    // its own payload and the addresses of its children.
+    struct NodeKey{
+        ExprKind kind;
+        long long value;
+        std::string name;
+        std::vector<const Expression*> children;
+
+        bool operator==(const NodeKey& other) const{
+            return kind == other.kind && value == other.value && name == other.name && children == other.children;
+        }
+    };
+
+    struct NodeKeyHash{
+        size_t operator()(const NodeKey& key) const;
+    };
+
+    static const Expression* make_constant(long long value);
+    static const Expression* make_constant(const Rational& value);
+    static const Expression* make_variable(const std::string& name);
+
+    static const Expression* make_sum(std::vector<const Expression*>&& terms);
+    static const Expression* make_product(std::vector<const Expression*>&& factors);
+    static const Expression* make_fraction(const Expression* dividend, const Expression* divisor);
+
+    static const Expression* make_power(const Expression* base, const Expression* power);
+    static const Expression* make_exp(const Expression* base, const Expression* power);
+    static const Expression* make_log(const Expression* base, const Expression* arg);
+    static const Expression* make_sin(const Expression* arg);
+    static const Expression* make_cos(const Expression* arg);
+    static const Expression* make_tan(const Expression* arg);
+    static const Expression* make_cot(const Expression* arg);
+
+    // Number of distinct nodes owned by the current arena
+    static size_t node_count();
+};
+
+#endif // EXPRESSION_FACTORY_H
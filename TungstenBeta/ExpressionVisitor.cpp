@@ -0,0 +1,98 @@
+#include "ExpressionVisitor.h"
+#include "ExpressionFactory.h"
+
+#include <unordered_set>
+
+namespace{
+    struct ChildrenVisitor{
+        Children operator()(const Constant&) const { return Children(); }
+        Children operator()(const Variable&) const { return Children(); }
+        Children operator()(const operators::Sum& sum) const { return Children(sum.get_terms()); }
+        Children operator()(const operators::Product& product) const { return Children(product.get_factors()); }
+        Children operator()(const operators::Fraction& fraction) const { return Children(fraction.get_dividend(), fraction.get_divisor()); }
+        Children operator()(const ElementaryFunctions::Power& power) const { return Children(power.get_base(), power.get_power()); }
+        Children operator()(const ElementaryFunctions::Exp& exp) const { return Children(exp.get_base(), exp.get_power()); }
+        Children operator()(const ElementaryFunctions::Log& log) const { return Children(log.get_base(), log.get_arg()); }
+        Children operator()(const ElementaryFunctions::Sin& sin) const { return Children(sin.get_arg()); }
+        Children operator()(const ElementaryFunctions::Cos& cos) const { return Children(cos.get_arg()); }
+        Children operator()(const ElementaryFunctions::Tan& tan) const { return Children(tan.get_arg()); }
+        Children operator()(const ElementaryFunctions::Cot& cot) const { return Children(cot.get_arg()); }
+    };
+}
+
+Children children(const Expression* expr){
+    return visit(expr, ChildrenVisitor());
+}
+
+const Expression* rebuild(const Expression* expr, std::vector<const Expression*>&& newChildren){
+    switch (expr->kind()){
+        case ExprKind::Constant:
+        case ExprKind::Variable:
+            return expr;
+        case ExprKind::Sum:
+            return ExpressionFactory::make_sum(std::move(newChildren));
+        case ExprKind::Product:
+            return ExpressionFactory::make_product(std::move(newChildren));
+        case ExprKind::Fraction:
+            return ExpressionFactory::make_fraction(newChildren[0], newChildren[1]);
+        case ExprKind::Power:
+            return ExpressionFactory::make_power(newChildren[0], newChildren[1]);
+        case ExprKind::Exp:
+            return ExpressionFactory::make_exp(newChildren[0], newChildren[1]);
+        case ExprKind::Log:
+            return ExpressionFactory::make_log(newChildren[0], newChildren[1]);
+        case ExprKind::Sin:
+            return ExpressionFactory::make_sin(newChildren[0]);
+        case ExprKind::Cos:
+            return ExpressionFactory::make_cos(newChildren[0]);
+        case ExprKind::Tan:
+            return ExpressionFactory::make_tan(newChildren[0]);
+        case ExprKind::Cot:
+            return ExpressionFactory::make_cot(newChildren[0]);
+    }
+    return expr;
+}
+
+namespace{
+    const Expression* transform_node(const Expression* expr, const std::function<const Expression*(const Expression*)>& fn,
+                                     std::unordered_map<const Expression*, const Expression*>& done){
+        auto it = done.find(expr);
+        if (it != done.end()){
+            return it->second;
+        }
+
+        Children oldChildren = children(expr);
+        std::vector<const Expression*> newChildren;
+        newChildren.reserve(oldChildren.size());
+        bool changed = false;
+        for (const Expression* child : oldChildren){
+            newChildren.push_back(transform_node(child, fn, done));
+            changed = changed || (newChildren.back() != child);
+        }
+
+        const Expression* result = fn(changed ? rebuild(expr, std::move(newChildren)) : expr);
+        done.emplace(expr, result);
+        return result;
+    }
+
+    void visit_node(const Expression* expr, const std::function<void(const Expression*)>& fn,
+                    std::unordered_set<const Expression*>& seen){
+        if (!seen.insert(expr).second){
+            return;
+        }
+        for (const Expression* child : children(expr)){
+            visit_node(child, fn, seen);
+        }
+        fn(expr);
+    }
+}
+
+const Expression* transform(const Expression* expr, const std::function<const Expression*(const Expression*)>& fn){
+    std::unordered_map<const Expression*, const Expression*> done;
+    return transform_node(expr, fn, done);
+}
+
+void for_each_node(const Expression* expr, const std::function<void(const Expression*)>& fn){
+    std::unordered_set<const Expression*> seen;
+    visit_node(expr, fn, seen);
+}
@@ -0,0 +1,81 @@
+#ifndef EXPRESSION_VISITOR_H
+#define EXPRESSION_VISITOR_H
+
+#include "Expression.h"
+#include "Constant.h"
+#include "Variable.h"
+#include "operators.h"
+#include "ElementaryFunctions.h"
+
+#include <functional>
+
+// Calls visitor with the node cast to its concrete class. The switch on
+// ExprKind compiles to a jump table, so no RTTI is involved. The visitor must
+// accept every node class (overloads or a generic lambda).
+template <typename Visitor>
+decltype(auto) visit(const Expression* expr, Visitor&& visitor){
+    switch (expr->kind()){
+        case ExprKind::Constant:
+            return visitor(static_cast<const Constant&>(*expr));
+        case ExprKind::Variable:
+            return visitor(static_cast<const Variable&>(*expr));
+        case ExprKind::Sum:
+            return visitor(static_cast<const operators::Sum&>(*expr));
+        case ExprKind::Product:
+            return visitor(static_cast<const operators::Product&>(*expr));
+        case ExprKind::Fraction:
+            return visitor(static_cast<const operators::Fraction&>(*expr));
+        case ExprKind::Power:
+            return visitor(static_cast<const ElementaryFunctions::Power&>(*expr));
+        case ExprKind::Exp:
+            return visitor(static_cast<const ElementaryFunctions::Exp&>(*expr));
+        case ExprKind::Log:
+            return visitor(static_cast<const ElementaryFunctions::Log&>(*expr));
+        case ExprKind::Sin:
+            return visitor(static_cast<const ElementaryFunctions::Sin&>(*expr));
+        case ExprKind::Cos:
+            return visitor(static_cast<const ElementaryFunctions::Cos&>(*expr));
+        case ExprKind::Tan:
+            return visitor(static_cast<const ElementaryFunctions::Tan&>(*expr));
+        case ExprKind::Cot:
+        default:
+            return visitor(static_cast<const ElementaryFunctions::Cot&>(*expr));
+    }
+}
+
+// Direct children of a node without copying them: the terms of sums and
+// products are viewed in place, the one or two operands of other nodes are
+// held inline. A view of a sum or product is valid while the node is.
+class Children{
+public:
+    Children() = default;
+    explicit Children(const std::vector<const Expression*>& list) : list_(list.data()), size_(list.size()) {}
+    explicit Children(const Expression* operand) : size_(1), operands_{operand, nullptr} {}
+    Children(const Expression* first, const Expression* second) : size_(2), operands_{first, second} {}
+
+    const Expression* const* begin() const { return list_ != nullptr ? list_ : operands_; }
+    const Expression* const* end() const { return begin() + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const Expression* operator[](size_t i) const { return begin()[i]; }
+
+private:
+    const Expression* const* list_ = nullptr;
+    size_t size_ = 0;
+    const Expression* operands_[2] = {nullptr, nullptr};
+};
+
+// Direct children in the order used by rebuild()
+Children children(const Expression* expr);
+
+// Builds a node of the same kind and payload as expr with new children
+const Expression* rebuild(const Expression* expr, std::vector<const Expression*>&& newChildren);
+
+// Bottom-up rewrite: children are transformed first, the node is rebuilt
+// from them and then passed to fn. Shared subtrees are transformed once.
+const Expression* transform(const Expression* expr, const std::function<const Expression*(const Expression*)>& fn);
+
+// Calls fn once for every distinct node reachable from expr, children first
+void for_each_node(const Expression* expr, const std::function<void(const Expression*)>& fn);
+
+#endif // EXPRESSION_VISITOR_H
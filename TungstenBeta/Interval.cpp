@@ -0,0 +1,240 @@
+#include "Interval.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace{
+    const double INF = std::numeric_limits<double>::infinity();
+
+    double down(double value){
+        return std::nextafter(value, -INF);
+    }
+
+    double up(double value){
+        return std::nextafter(value, INF);
+    }
+
+    // 0 * inf is 0 here: a zero bound is exact, and the infinite one only
+    // stands for arbitrarily large finite values
+    double mul(double a, double b){
+        return (a == 0 || b == 0) ? 0 : a * b;
+    }
+
+    // Whether offset + k * period lies in [lo, hi] for some integer k. The
+    // test is widened by a few ulps so that extrema on the very edge of the
+    // interval are never missed; a false positive only loosens the bound.
+    bool contains_point(double lo, double hi, double offset, double period){
+        double slack = 4 * DBL_EPSILON * std::max({1.0, std::fabs(lo), std::fabs(hi)});
+        double k = std::ceil((lo - slack - offset) / period);
+        return offset + k * period <= hi + slack;
+    }
+
+    Interval sorted(double a, double b){
+        return Interval{down(std::min(a, b)), up(std::max(a, b))};
+    }
+
+    bool is_integer(double value){
+        return std::fabs(value) < 9007199254740992.0 && std::nearbyint(value) == value;
+    }
+}
+
+Interval Interval::entire(){
+    return Interval{-INF, INF};
+}
+
+Interval Interval::empty(){
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    return Interval{nan, nan};
+}
+
+double Interval::midpoint() const{
+    if (lo == -INF && hi == INF){
+        return 0;
+    }
+    return 0.5 * lo + 0.5 * hi;
+}
+
+Interval Interval::hull(Interval a, Interval b){
+    if (a.is_empty()){
+        return b;
+    }
+    if (b.is_empty()){
+        return a;
+    }
+    return Interval{std::min(a.lo, b.lo), std::max(a.hi, b.hi)};
+}
+
+Interval operator+(Interval lhs, Interval rhs){
+    if (lhs.is_empty() || rhs.is_empty()){
+        return Interval::empty();
+    }
+    return Interval{down(lhs.lo + rhs.lo), up(lhs.hi + rhs.hi)};
+}
+
+Interval operator-(Interval x){
+    return Interval{-x.hi, -x.lo};
+}
+
+Interval operator-(Interval lhs, Interval rhs){
+    return lhs + (-rhs);
+}
+
+Interval operator*(Interval lhs, Interval rhs){
+    if (lhs.is_empty() || rhs.is_empty()){
+        return Interval::empty();
+    }
+    double a = mul(lhs.lo, rhs.lo);
+    double b = mul(lhs.lo, rhs.hi);
+    double c = mul(lhs.hi, rhs.lo);
+    double d = mul(lhs.hi, rhs.hi);
+    return Interval{down(std::min({a, b, c, d})), up(std::max({a, b, c, d}))};
+}
+
+Interval operator/(Interval lhs, Interval rhs){
+    if (lhs.is_empty() || rhs.is_empty() || (rhs.lo == 0 && rhs.hi == 0)){
+        return Interval::empty();
+    }
+    if (rhs.lo > 0 || rhs.hi < 0){
+        double a = lhs.lo / rhs.lo;
+        double b = lhs.lo / rhs.hi;
+        double c = lhs.hi / rhs.lo;
+        double d = lhs.hi / rhs.hi;
+        return Interval{down(std::min({a, b, c, d})), up(std::max({a, b, c, d}))};
+    }
+    // The divisor touches zero from one side only: the quotient is a half-line
+    if (rhs.lo == 0){
+        if (lhs.lo >= 0){
+            return Interval{down(lhs.lo / rhs.hi), INF};
+        }
+        if (lhs.hi <= 0){
+            return Interval{-INF, up(lhs.hi / rhs.hi)};
+        }
+    }
+    else if (rhs.hi == 0){
+        if (lhs.lo >= 0){
+            return Interval{-INF, up(lhs.lo / rhs.lo)};
+        }
+        if (lhs.hi <= 0){
+            return Interval{down(lhs.hi / rhs.lo), INF};
+        }
+    }
+    return Interval::entire();
+}
+
+Interval Interval::pown(Interval base, long long exponent){
+    if (base.is_empty()){
+        return base;
+    }
+    if (exponent == 0){
+        return Interval::point(1);
+    }
+    if (exponent < 0){
+        return Interval::point(1) / pown(base, -exponent);
+    }
+    double n = static_cast<double>(exponent);
+    double low = std::pow(base.lo, n);
+    double high = std::pow(base.hi, n);
+    if (exponent % 2 == 1){
+        return Interval{down(low), up(high)};
+    }
+    if (base.lo >= 0){
+        return Interval{std::max(0.0, down(low)), up(high)};
+    }
+    if (base.hi <= 0){
+        return Interval{std::max(0.0, down(high)), up(low)};
+    }
+    return Interval{0, up(std::max(low, high))};
+}
+
+Interval Interval::pow(Interval base, Interval power){
+    if (base.is_empty() || power.is_empty()){
+        return Interval::empty();
+    }
+    if (power.lo == power.hi && is_integer(power.lo)){
+        return pown(base, static_cast<long long>(power.lo));
+    }
+    // Non-integer exponents: std::pow is NaN for negative bases
+    if (base.hi < 0){
+        return Interval::empty();
+    }
+    base.lo = std::max(base.lo, 0.0);
+    if (power.lo == power.hi){
+        double p = power.lo;
+        double low = std::pow(base.lo, p);
+        double high = std::pow(base.hi, p);
+        return p > 0 ? Interval{std::max(0.0, down(low)), up(high)} : Interval{std::max(0.0, down(high)), up(low)};
+    }
+    return exp(power * log(base));
+}
+
+Interval Interval::exp(Interval x){
+    if (x.is_empty()){
+        return x;
+    }
+    return Interval{std::max(0.0, down(std::exp(x.lo))), up(std::exp(x.hi))};
+}
+
+Interval Interval::log(Interval x){
+    if (x.is_empty() || x.hi < 0){
+        return Interval::empty();
+    }
+    return Interval{down(std::log(std::max(x.lo, 0.0))), up(std::log(x.hi))};
+}
+
+Interval Interval::sin(Interval x){
+    if (x.is_empty()){
+        return x;
+    }
+    if (!(x.width() < 2 * M_PI)){
+        return Interval{-1, 1};
+    }
+    Interval result = sorted(std::sin(x.lo), std::sin(x.hi));
+    if (contains_point(x.lo, x.hi, M_PI / 2, 2 * M_PI)){
+        result.hi = 1;
+    }
+    if (contains_point(x.lo, x.hi, -M_PI / 2, 2 * M_PI)){
+        result.lo = -1;
+    }
+    return Interval{std::max(result.lo, -1.0), std::min(result.hi, 1.0)};
+}
+
+Interval Interval::cos(Interval x){
+    if (x.is_empty()){
+        return x;
+    }
+    if (!(x.width() < 2 * M_PI)){
+        return Interval{-1, 1};
+    }
+    Interval result = sorted(std::cos(x.lo), std::cos(x.hi));
+    if (contains_point(x.lo, x.hi, 0, 2 * M_PI)){
+        result.hi = 1;
+    }
+    if (contains_point(x.lo, x.hi, M_PI, 2 * M_PI)){
+        result.lo = -1;
+    }
+    return Interval{std::max(result.lo, -1.0), std::min(result.hi, 1.0)};
+}
+
+Interval Interval::tan(Interval x){
+    if (x.is_empty()){
+        return x;
+    }
+    // Increasing between the poles at pi/2 + k * pi
+    if (!(x.width() < M_PI) || contains_point(x.lo, x.hi, M_PI / 2, M_PI)){
+        return Interval::entire();
+    }
+    return Interval{down(std::tan(x.lo)), up(std::tan(x.hi))};
+}
+
+Interval Interval::cot(Interval x){
+    if (x.is_empty()){
+        return x;
+    }
+    // Decreasing between the poles at k * pi; 1 / tan rounds twice
+    if (!(x.width() < M_PI) || contains_point(x.lo, x.hi, 0, M_PI)){
+        return Interval::entire();
+    }
+    return Interval{down(down(1 / std::tan(x.hi))), up(up(1 / std::tan(x.lo)))};
+}
@@ -0,0 +1,43 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+// Closed interval [lo, hi] of reals for interval arithmetic. Every operation
+// rounds its bounds outward by one ulp (libm functions are assumed accurate
+// to within that), so the result always encloses the exact range. Infinite
+// bounds are allowed; an interval with NaN bounds is empty, e.g. the log of
+// a negative range.
+struct Interval{
+    double lo;
+    double hi;
+
+    static Interval point(double value) { return Interval{value, value}; }
+    static Interval entire();
+    static Interval empty();
+
+    bool is_empty() const { return !(lo <= hi); }
+    bool contains(double value) const { return lo <= value && value <= hi; }
+    double width() const { return hi - lo; }
+    double midpoint() const;
+
+    static Interval hull(Interval a, Interval b);
+
+    // Integer power, tighter than the general one for negative bases
+    static Interval pown(Interval base, long long exponent);
+    // base^power as std::pow computes it: integer powers of any base,
+    // otherwise only the non-negative part of base counts
+    static Interval pow(Interval base, Interval power);
+    static Interval exp(Interval x);
+    static Interval log(Interval x);
+    static Interval sin(Interval x);
+    static Interval cos(Interval x);
+    static Interval tan(Interval x);
+    static Interval cot(Interval x);
+};
+
+Interval operator+(Interval lhs, Interval rhs);
+Interval operator-(Interval lhs, Interval rhs);
+Interval operator-(Interval x);
+Interval operator*(Interval lhs, Interval rhs);
+Interval operator/(Interval lhs, Interval rhs);
+
+#endif // INTERVAL_H
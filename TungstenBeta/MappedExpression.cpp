@@ -0,0 +1,476 @@
+#include "MappedExpression.h"
+#include "ExpressionVisitor.h"
+#include "ExpressionFactory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace{
+    const char MAGIC[4] = {'T', 'N', 'G', 'X'};
+    // Reads back as a different value on a host of the other byte order
+    const uint32_t ORDER_MARK = 0x01020304;
+
+    // Stable codes of the file, independent of the order of ExprKind
+    enum FileKind : uint8_t{
+        KindConstant, KindE, KindPi, KindVariable,
+        KindSum, KindProduct, KindFraction, KindPower, KindExp, KindLog,
+        KindSin, KindCos, KindTan, KindCot
+    };
+
+    struct ConstantRecord{
+        int64_t numerator;
+        int64_t denominator;
+    };
+
+    struct StringRecord{
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    size_t aligned(size_t offset){
+        return (offset + 7) & ~size_t(7);
+    }
+
+    [[noreturn]] void invalid(const std::string& reason){
+        throw std::runtime_error("MappedExpression: " + reason);
+    }
+}
+
+struct MappedExpression::Section{
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct MappedExpression::Node{
+    uint8_t kind;
+    uint8_t reserved[3];
+    uint32_t count;
+    uint32_t first;
+    uint32_t reserved2;
+    double value;
+};
+
+struct MappedExpression::Header{
+    char magic[4];
+    uint32_t version;
+    uint32_t root;
+    uint32_t byte_order;
+    Section nodes;
+    Section children;
+    Section constants;
+    Section strings;
+    Section bytes;
+};
+
+std::string MappedExpression::serialize(const Expression* expr){
+    static_assert(sizeof(Node) == 24, "node records are part of the file format");
+    std::unordered_map<const Expression*, uint32_t> index;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> childIndices;
+    std::vector<ConstantRecord> constants;
+    std::vector<StringRecord> strings;
+    std::string bytes;
+    std::unordered_map<std::string, uint32_t> interned;
+
+    auto intern = [&](const std::string& text){
+        auto found = interned.find(text);
+        if (found != interned.end()){
+            return found->second;
+        }
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        strings.push_back(StringRecord{bytes.size(), text.size()});
+        bytes += text;
+        interned.emplace(text, id);
+        return id;
+    };
+
+    for_each_node(expr, [&](const Expression* node){
+        Node record{};
+        Children operands = children(node);
+        record.count = static_cast<uint32_t>(operands.size());
+        record.first = static_cast<uint32_t>(childIndices.size());
+        for (const Expression* operand : operands){
+            childIndices.push_back(index.at(operand));
+        }
+        switch (node->kind()){
+            case ExprKind::Constant:{
+                record.value = node->calculate(EvalContext());
+                if (node == Constant::e || node == Constant::pi){
+                    record.kind = node == Constant::e ? KindE : KindPi;
+                    break;
+                }
+                record.kind = KindConstant;
+                record.first = static_cast<uint32_t>(constants.size());
+                const Rational& value = static_cast<const Constant*>(node)->get_value();
+                if (value.is_small()){
+                    constants.push_back(ConstantRecord{value.numerator(), value.denominator()});
+                }
+                else{
+                    constants.push_back(ConstantRecord{intern(value.to_string()), 0});
+                }
+                break;
+            }
+            case ExprKind::Variable:
+                record.kind = KindVariable;
+                record.first = intern(static_cast<const Variable*>(node)->get_name());
+                break;
+            case ExprKind::Sum: record.kind = KindSum; break;
+            case ExprKind::Product: record.kind = KindProduct; break;
+            case ExprKind::Fraction: record.kind = KindFraction; break;
+            case ExprKind::Power: record.kind = KindPower; break;
+            case ExprKind::Exp: record.kind = KindExp; break;
+            case ExprKind::Log: record.kind = KindLog; break;
+            case ExprKind::Sin: record.kind = KindSin; break;
+            case ExprKind::Cos: record.kind = KindCos; break;
+            case ExprKind::Tan: record.kind = KindTan; break;
+            case ExprKind::Cot: record.kind = KindCot; break;
+        }
+        index.emplace(node, static_cast<uint32_t>(nodes.size()));
+        nodes.push_back(record);
+    });
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.root = static_cast<uint32_t>(nodes.size() - 1);
+    header.byte_order = ORDER_MARK;
+    size_t offset = sizeof(Header);
+    auto place = [&](Section& section, size_t count, size_t size){
+        section.offset = offset;
+        section.count = count;
+        offset = aligned(offset + count * size);
+    };
+    place(header.nodes, nodes.size(), sizeof(Node));
+    place(header.children, childIndices.size(), sizeof(uint32_t));
+    place(header.constants, constants.size(), sizeof(ConstantRecord));
+    place(header.strings, strings.size(), sizeof(StringRecord));
+    place(header.bytes, bytes.size(), 1);
+
+    std::string image(offset, '\0');
+    auto copy = [&](const Section& section, const void* data, size_t size){
+        if (section.count != 0){
+            std::memcpy(&image[section.offset], data, section.count * size);
+        }
+    };
+    std::memcpy(&image[0], &header, sizeof(Header));
+    copy(header.nodes, nodes.data(), sizeof(Node));
+    copy(header.children, childIndices.data(), sizeof(uint32_t));
+    copy(header.constants, constants.data(), sizeof(ConstantRecord));
+    copy(header.strings, strings.data(), sizeof(StringRecord));
+    copy(header.bytes, bytes.data(), 1);
+    return image;
+}
+
+void MappedExpression::write(const Expression* expr, const std::string& path){
+    std::string image = serialize(expr);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    file.close();
+    if (!file){
+        invalid("cannot write " + path);
+    }
+}
+
+MappedExpression::MappedExpression(const std::string& path, size_t offset){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        invalid("cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || offset % 8 != 0 || info.st_size < static_cast<off_t>(offset + sizeof(Header))){
+        close(fd);
+        invalid(path + " is not an expression image");
+    }
+    length_ = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED){
+        invalid("cannot map " + path + ": " + std::strerror(errno));
+    }
+    data_ = static_cast<const char*>(data);
+    image_ = data_ + offset;
+    try{
+        validate();
+    } catch (...){
+        release();
+        throw;
+    }
+}
+
+MappedExpression::~MappedExpression(){
+    release();
+}
+
+MappedExpression::MappedExpression(MappedExpression&& other) noexcept{
+    *this = std::move(other);
+}
+
+MappedExpression& MappedExpression::operator=(MappedExpression&& other) noexcept{
+    if (this != &other){
+        release();
+        data_ = other.data_;
+        length_ = other.length_;
+        image_ = other.image_;
+        nodes_ = other.nodes_;
+        children_ = other.children_;
+        node_count_ = other.node_count_;
+        root_ = other.root_;
+        strings_ = std::move(other.strings_);
+        variables_ = std::move(other.variables_);
+        slots_ = std::move(other.slots_);
+        other.data_ = nullptr;
+        other.length_ = 0;
+        other.node_count_ = 0;
+    }
+    return *this;
+}
+
+void MappedExpression::release(){
+    if (data_ != nullptr){
+        munmap(const_cast<char*>(data_), length_);
+        data_ = nullptr;
+    }
+}
+
+// One pass over the records: every index must point into its section and
+// every child must come before its parent, so evaluation can never read
+// outside the file or loop
+void MappedExpression::validate(){
+    Header header;
+    std::memcpy(&header, image_, sizeof(Header));
+    size_t length = length_ - (image_ - data_);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0){
+        invalid("not an expression image");
+    }
+    if (header.byte_order != ORDER_MARK){
+        invalid("image has the wrong byte order");
+    }
+    if (header.version != VERSION){
+        invalid("unsupported version " + std::to_string(header.version));
+    }
+    auto check = [&](const Section& section, size_t size){
+        if (section.offset % 8 != 0 || section.offset < sizeof(Header) || section.offset > length ||
+            section.count > (length - section.offset) / size){
+            invalid("section out of bounds");
+        }
+        return image_ + section.offset;
+    };
+    nodes_ = reinterpret_cast<const Node*>(check(header.nodes, sizeof(Node)));
+    children_ = reinterpret_cast<const uint32_t*>(check(header.children, sizeof(uint32_t)));
+    auto constants = reinterpret_cast<const ConstantRecord*>(check(header.constants, sizeof(ConstantRecord)));
+    auto strings = reinterpret_cast<const StringRecord*>(check(header.strings, sizeof(StringRecord)));
+    const char* bytes = check(header.bytes, 1);
+    node_count_ = header.nodes.count;
+    root_ = header.root;
+    if (root_ >= node_count_){
+        invalid("root out of bounds");
+    }
+
+    strings_.clear();
+    for (size_t i = 0; i < header.strings.count; ++i){
+        if (strings[i].offset > header.bytes.count || strings[i].length > header.bytes.count - strings[i].offset){
+            invalid("string out of bounds");
+        }
+        strings_.emplace_back(bytes + strings[i].offset, strings[i].length);
+    }
+    slots_.assign(strings_.size(), -1);
+    variables_.clear();
+
+    for (size_t i = 0; i < node_count_; ++i){
+        const Node& node = nodes_[i];
+        size_t arity = 0;
+        switch (node.kind){
+            case KindConstant:
+                if (node.count != 0 || node.first >= header.constants.count){
+                    invalid("constant out of bounds");
+                }
+                if (constants[node.first].denominator == 0 &&
+                    static_cast<uint64_t>(constants[node.first].numerator) >= header.strings.count){
+                    invalid("constant out of bounds");
+                }
+                continue;
+            case KindE:
+            case KindPi:
+                arity = 0;
+                break;
+            case KindVariable:
+                if (node.count != 0 || node.first >= strings_.size()){
+                    invalid("variable out of bounds");
+                }
+                if (slots_[node.first] < 0){
+                    variables_.emplace_back(strings_[node.first]);
+                    slots_[node.first] = EvalContext::slot_of(variables_.back());
+                }
+                continue;
+            case KindSum:
+            case KindProduct:
+                arity = node.count;
+                break;
+            case KindFraction:
+            case KindPower:
+            case KindExp:
+            case KindLog:
+                arity = 2;
+                break;
+            case KindSin:
+            case KindCos:
+            case KindTan:
+            case KindCot:
+                arity = 1;
+                break;
+            default:
+                invalid("unknown node kind " + std::to_string(node.kind));
+        }
+        if (node.count != arity || node.first > header.children.count || arity > header.children.count - node.first){
+            invalid("children out of bounds");
+        }
+        for (size_t c = 0; c < arity; ++c){
+            if (children_[node.first + c] >= i){
+                invalid("child does not precede its parent");
+            }
+        }
+    }
+}
+
+double MappedExpression::calculate(const EvalContext& context) const{
+    thread_local std::vector<double> values;
+    values.resize(node_count_);
+    for (size_t i = 0; i <= root_; ++i){
+        const Node& node = nodes_[i];
+        const uint32_t* operand = children_ + node.first;
+        double result;
+        switch (node.kind){
+            case KindConstant:
+                result = node.value;
+                break;
+            case KindE:
+                result = M_E;
+                break;
+            case KindPi:
+                result = M_PI;
+                break;
+            case KindVariable:
+                result = context.get(slots_[node.first]);
+                break;
+            case KindSum:
+                result = 0;
+                for (uint32_t c = 0; c < node.count; ++c){
+                    result += values[operand[c]];
+                }
+                break;
+            case KindProduct:
+                result = 1;
+                for (uint32_t c = 0; c < node.count; ++c){
+                    result *= values[operand[c]];
+                }
+                break;
+            case KindFraction:
+                result = values[operand[0]] / values[operand[1]];
+                break;
+            case KindPower:
+                result = std::pow(values[operand[0]], values[operand[1]]);
+                break;
+            case KindExp:
+                result = std::exp(values[operand[1]] * std::log(values[operand[0]]));
+                break;
+            case KindLog:
+                result = std::log(values[operand[1]]) / std::log(values[operand[0]]);
+                break;
+            case KindSin:
+                result = std::sin(values[operand[0]]);
+                break;
+            case KindCos:
+                result = std::cos(values[operand[0]]);
+                break;
+            case KindTan:
+                result = std::tan(values[operand[0]]);
+                break;
+            case KindCot:
+            default:
+                result = 1 / std::tan(values[operand[0]]);
+                break;
+        }
+        values[i] = result;
+    }
+    return values[root_];
+}
+
+const Expression* MappedExpression::to_expression() const{
+    auto header = reinterpret_cast<const Header*>(image_);
+    auto constants = reinterpret_cast<const ConstantRecord*>(image_ + header->constants.offset);
+    std::vector<const Expression*> built(root_ + 1);
+    for (size_t i = 0; i <= root_; ++i){
+        const Node& node = nodes_[i];
+        const uint32_t* operand = children_ + node.first;
+        const Expression* result;
+        switch (node.kind){
+            case KindConstant:{
+                const ConstantRecord& constant = constants[node.first];
+                if (constant.denominator != 0){
+                    result = ExpressionFactory::make_constant(Rational(constant.numerator, constant.denominator));
+                    break;
+                }
+                std::string_view text = strings_[constant.numerator];
+                size_t slash = text.find('/');
+                BigInt numerator = BigInt::from_string(text.substr(0, slash));
+                BigInt denominator = slash == std::string_view::npos ? BigInt(1) : BigInt::from_string(text.substr(slash + 1));
+                result = ExpressionFactory::make_constant(Rational(numerator, denominator));
+                break;
+            }
+            case KindE:
+                result = Constant::e;
+                break;
+            case KindPi:
+                result = Constant::pi;
+                break;
+            case KindVariable:
+                result = ExpressionFactory::make_variable(std::string(strings_[node.first]));
+                break;
+            case KindSum:
+            case KindProduct:{
+                std::vector<const Expression*> operands;
+                for (uint32_t c = 0; c < node.count; ++c){
+                    operands.push_back(built[operand[c]]);
+                }
+                result = node.kind == KindSum ? ExpressionFactory::make_sum(std::move(operands))
+                                              : ExpressionFactory::make_product(std::move(operands));
+                break;
+            }
+            case KindFraction:
+                result = ExpressionFactory::make_fraction(built[operand[0]], built[operand[1]]);
+                break;
+            case KindPower:
+                result = ExpressionFactory::make_power(built[operand[0]], built[operand[1]]);
+                break;
+            case KindExp:
+                result = ExpressionFactory::make_exp(built[operand[0]], built[operand[1]]);
+                break;
+            case KindLog:
+                result = ExpressionFactory::make_log(built[operand[0]], built[operand[1]]);
+                break;
+            case KindSin:
+                result = ExpressionFactory::make_sin(built[operand[0]]);
+                break;
+            case KindCos:
+                result = ExpressionFactory::make_cos(built[operand[0]]);
+                break;
+            case KindTan:
+                result = ExpressionFactory::make_tan(built[operand[0]]);
+                break;
+            case KindCot:
+            default:
+                result = ExpressionFactory::make_cot(built[operand[0]]);
+                break;
+        }
+        built[i] = result;
+    }
+    return built[root_];
+}
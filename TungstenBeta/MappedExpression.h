@@ -0,0 +1,80 @@
+#ifndef MAPPED_EXPRESSION_H
+#define MAPPED_EXPRESSION_H
+
+#include "Expression.h"
+
+#include <cstdint>
+#include <string_view>
+
+// Versioned binary image of an expression DAG, read by mapping the file.
+// Nodes are fixed-size records in children-first order (the root is last),
+// children are stored as indices of earlier records, constants keep their
+// double value inline and variable names are interned once. Opening only
+// checks the indices, so a large model loads in the time of one pass over
+// its records, and processes mapping the same file share its pages.
+//
+// The file is little-endian:
+//   header    magic "TNGX", version, root, byte-order mark, then offset and
+//             count of each section below
+//   nodes     {u8 kind, u8[3] reserved, u32 count, u32 first, u32 reserved,
+//             f64 value}; count children start at children[first], first
+//             is a constant index for constants and a string index for
+//             variables
+//   children  u32 node indices
+//   constants {i64 numerator, i64 denominator}; a zero denominator marks a
+//             value beyond 64 bits, stored as text in string numerator
+//   strings   {u64 offset, u64 length} into bytes
+//   bytes     string contents
+class MappedExpression{
+public:
+    static const uint32_t VERSION = 1;
+
+    // The image of expr; shared subtrees are stored once
+    static std::string serialize(const Expression* expr);
+    // Throws std::runtime_error if the file cannot be written
+    static void write(const Expression* expr, const std::string& path);
+
+    // Maps the file read-only; the image starts at offset, a multiple of 8,
+    // so it can follow other data. Throws std::runtime_error if the file
+    // cannot be read or holds no valid image of this version there.
+    explicit MappedExpression(const std::string& path, size_t offset = 0);
+    ~MappedExpression();
+
+    MappedExpression(MappedExpression&& other) noexcept;
+    MappedExpression& operator=(MappedExpression&& other) noexcept;
+    MappedExpression(const MappedExpression&) = delete;
+    MappedExpression& operator=(const MappedExpression&) = delete;
+
+    size_t size() const { return node_count_; }
+    const std::vector<std::string>& variables() const { return variables_; }
+
+    // Evaluates straight from the mapped records, in the same order of
+    // operations as Expression::calculate
+    double calculate(const EvalContext& context) const;
+    // Builds the expression in the current arena
+    const Expression* to_expression() const;
+
+private:
+    struct Header;
+    struct Section;
+    struct Node;
+
+    const char* data_ = nullptr;
+    size_t length_ = 0;
+    // Start of the image within the mapping
+    const char* image_ = nullptr;
+    const Node* nodes_ = nullptr;
+    const uint32_t* children_ = nullptr;
+    size_t node_count_ = 0;
+    size_t root_ = 0;
+    // Interned strings; variable nodes refer to them by index
+    std::vector<std::string_view> strings_;
+    std::vector<std::string> variables_;
+    // EvalContext slot per string, -1 for strings that name no variable
+    std::vector<int> slots_;
+
+    void validate();
+    void release();
+};
+
+#endif // MAPPED_EXPRESSION_H
@@ -3,70 +3,289 @@
 #include "Constant.h"
 #include "Variable.h"
 #include "ElementaryFunctions.h"
+#include "ExpressionFactory.h"
+#include "ExpressionVisitor.h"
+#include "CompiledExpression.h"
+#include "TaylorSeries.h"
+
+#include <memory>
+
+namespace{
+    // PA = LU with partial pivoting, stored in place
+    class LUFactorization{
+    public:
+        bool factor(std::vector<double> matrix, size_t n){
+            n_ = n;
+            lu_ = std::move(matrix);
+            pivot_.resize(n);
+            for (size_t k = 0; k < n; ++k){
+                size_t best = k;
+                for (size_t i = k + 1; i < n; ++i){
+                    if (std::abs(at(i, k)) > std::abs(at(best, k))){
+                        best = i;
+                    }
+                }
+                pivot_[k] = best;
+                if (at(best, k) == 0 || !std::isfinite(at(best, k))){
+                    return false;
+                }
+                if (best != k){
+                    for (size_t j = 0; j < n; ++j){
+                        std::swap(at(k, j), at(best, j));
+                    }
+                }
+                for (size_t i = k + 1; i < n; ++i){
+                    at(i, k) /= at(k, k);
+                    for (size_t j = k + 1; j < n; ++j){
+                        at(i, j) -= at(i, k) * at(k, j);
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Solves A x = b in place
+        void solve(std::vector<double>& b) const{
+            for (size_t k = 0; k < n_; ++k){
+                std::swap(b[k], b[pivot_[k]]);
+            }
+            for (size_t i = 0; i < n_; ++i){
+                for (size_t j = 0; j < i; ++j){
+                    b[i] -= at(i, j) * b[j];
+                }
+            }
+            for (size_t i = n_; i-- > 0;){
+                for (size_t j = i + 1; j < n_; ++j){
+                    b[i] -= at(i, j) * b[j];
+                }
+                b[i] /= at(i, i);
+            }
+        }
+
+        // Solves A^T x = b in place
+        void solve_transposed(std::vector<double>& b) const{
+            for (size_t i = 0; i < n_; ++i){
+                for (size_t j = 0; j < i; ++j){
+                    b[i] -= at(j, i) * b[j];
+                }
+                b[i] /= at(i, i);
+            }
+            for (size_t i = n_; i-- > 0;){
+                for (size_t j = i + 1; j < n_; ++j){
+                    b[i] -= at(j, i) * b[j];
+                }
+            }
+            for (size_t k = n_; k-- > 0;){
+                std::swap(b[k], b[pivot_[k]]);
+            }
+        }
+
+    private:
+        size_t n_ = 0;
+        std::vector<double> lu_;
+        std::vector<size_t> pivot_;
+
+        double& at(size_t i, size_t j) { return lu_[i * n_ + j]; }
+        double at(size_t i, size_t j) const { return lu_[i * n_ + j]; }
+    };
+
+    // Inverse Jacobian approximation H = H0 + sum u_k v_k^T, where H0 is
+    // the inverse of the last factored Jacobian (good Broyden method).
+    class BroydenInverse{
+    public:
+        LUFactorization lu;
+
+        void clear() { u_.clear(); v_.clear(); }
+        size_t size() const { return u_.size(); }
+
+        std::vector<double> apply(const std::vector<double>& z) const{
+            std::vector<double> result = z;
+            lu.solve(result);
+            for (size_t k = 0; k < u_.size(); ++k){
+                double scale = dot(v_[k], z);
+                for (size_t i = 0; i < result.size(); ++i){
+                    result[i] += u_[k][i] * scale;
+                }
+            }
+            return result;
+        }
+
+        std::vector<double> apply_transposed(const std::vector<double>& z) const{
+            std::vector<double> result = z;
+            lu.solve_transposed(result);
+            for (size_t k = 0; k < u_.size(); ++k){
+                double scale = dot(u_[k], z);
+                for (size_t i = 0; i < result.size(); ++i){
+                    result[i] += v_[k][i] * scale;
+                }
+            }
+            return result;
+        }
+
+        // H += (s - H y) (s^T H) / (s^T H y); false if the update is degenerate
+        bool update(const std::vector<double>& s, const std::vector<double>& y){
+            std::vector<double> hy = apply(y);
+            double denominator = dot(s, hy);
+            if (std::abs(denominator) < 1e-14 * std::sqrt(dot(s, s) * dot(hy, hy))){
+                return false;
+            }
+            std::vector<double> u(s.size());
+            for (size_t i = 0; i < s.size(); ++i){
+                u[i] = (s[i] - hy[i]) / denominator;
+            }
+            v_.push_back(apply_transposed(s));
+            u_.push_back(std::move(u));
+            return true;
+        }
+
+        static double dot(const std::vector<double>& a, const std::vector<double>& b){
+            double sum = 0;
+            for (size_t i = 0; i < a.size(); ++i){
+                sum += a[i] * b[i];
+            }
+            return sum;
+        }
+
+    private:
+        std::vector<std::vector<double>> u_;
+        std::vector<std::vector<double>> v_;
+    };
+
+    // The exact value of a finite double: its 53-bit mantissa times a power
+    // of two
+    Rational exact_rational(double value){
+        int exponent;
+        double mantissa = std::frexp(value, &exponent);
+        Rational result = static_cast<long long>(std::ldexp(mantissa, 53));
+        Rational power = 1;
+        Rational square = 2;
+        for (int shift = std::abs(exponent - 53); shift != 0; shift >>= 1){
+            if (shift & 1){
+                power *= square;
+            }
+            if (shift > 1){
+                square *= square;
+            }
+        }
+        return exponent >= 53 ? result * power : result / power;
+    }
+
+    double max_norm(const std::vector<double>& v){
+        double norm = 0;
+        for (double x : v){
+            norm = std::max(norm, std::abs(x));
+        }
+        return std::isnan(norm) ? INFINITY : norm;
+    }
+}
 
 const Expression* double_to_fraction(double value){
-    long long precision = 1000000000000;
-    long long numerator = static_cast<long long>(value * precision);
-    long long denominator = precision;
+    if (!std::isfinite(value)){
+        return Constant::ZERO;
+    }
+    // From 2^52 on every double is an integer: take it exactly
+    if (std::fabs(value) >= 4503599627370496.0){
+        return ExpressionFactory::make_constant(exact_rational(value));
+    }
 
-    long long gcd = std::gcd(numerator, denominator);
+    // Continued fraction convergents, until one reproduces the double or the
+    // denominator passes 10^12
+    const long long MAX_DENOMINATOR = 1000000000000;
+    long long numerator = 1, denominator = 0;
+    long long previousNumerator = 0, previousDenominator = 1;
+    double rest = value;
+    for (int i = 0; i < 64; ++i){
+        double whole = std::floor(rest);
+        long long nextNumerator, nextDenominator;
+        // Below 2^52 the first quotient always fits, so a convergent exists
+        if (std::fabs(whole) > 9e15
+            || __builtin_mul_overflow(static_cast<long long>(whole), numerator, &nextNumerator)
+            || __builtin_add_overflow(nextNumerator, previousNumerator, &nextNumerator)
+            || __builtin_mul_overflow(static_cast<long long>(whole), denominator, &nextDenominator)
+            || __builtin_add_overflow(nextDenominator, previousDenominator, &nextDenominator)
+            || nextDenominator > MAX_DENOMINATOR){
+            break;
+        }
+        previousNumerator = numerator;
+        previousDenominator = denominator;
+        numerator = nextNumerator;
+        denominator = nextDenominator;
 
-    numerator /= gcd;
-    denominator /= gcd;
+        if (static_cast<double>(numerator) / static_cast<double>(denominator) == value || rest == whole){
+            break;
+        }
+        rest = 1 / (rest - whole);
+    }
 
-    return new operators::Fraction(new Constant(numerator), new Constant(denominator));
+    return ExpressionFactory::make_constant(Rational(numerator, denominator));
 }
 
 const Expression* WholeFactorial(long long n){
     std::vector <const Expression*> factors;
-    factors.push_back(new Constant(1));
+    factors.push_back(ExpressionFactory::make_constant(1));
     for (long long i = 2; i <= n; ++i){
-        factors.push_back(new Constant(i));
+        factors.push_back(ExpressionFactory::make_constant(i));
     }
-    return new operators::Product(std::move(factors));
+    return ExpressionFactory::make_product(std::move(factors));
 }
 
-const Expression* Taylor_series(const Expression* f, const std::string& variable_name, double point){
-    const Expression* buff = Variable::variables[variable_name];
-    Variable::variables[variable_name] = double_to_fraction(point);
-
-    std::vector <const Expression*> terms;
-    std::vector <const Expression*> fNDerivative;
-    fNDerivative.push_back(f);
-    terms.push_back(f);
-
-    long long STEPS = 5;
-    for (long long i = 1; i < STEPS; ++i){
-        fNDerivative.push_back((fNDerivative[i - 1]->complex_derivative(variable_name))->simplify());
-        //std::cout << fNDerivative[i]->calculate() << "     " << double_to_fraction(fNDerivative[i]->calculate())->to_string() << "\n";
-        const Expression* k = new operators::Fraction(fNDerivative[i]->plug_variable(variable_name), new operators::Product({new Constant(i), fNDerivative[i - 1]->plug_variable(variable_name)}));
-        
-        const Expression* term = new operators::Product({
-            k,
-            new operators::Sum({new Variable(variable_name), new operators::Product({new Constant(-1), double_to_fraction(point)})}),
-            terms[i - 1]->plug_variable(variable_name)
-        });
-        terms.push_back(term->simplify());
-        std::cout << std::endl;
-        std::cout << i << ":  " << "der:  " << fNDerivative[i]->simplify()->to_string() << "\n\n    term: " << term->simplify()->to_string() << std::endl;
-        std::cout << std::endl;
-        
-    }
-
-    Variable::variables[variable_name] = buff;
-    return (new operators::Sum(std::move(terms)))->simplify();
+const Expression* Taylor_series(const Expression* f, const std::string& variable_name, double point, size_t order){
+    // Exact coefficients when the point and every value at it are rational,
+    // the exact values of the floating point ones otherwise
+    const Expression* at_point = double_to_fraction(point);
+    const Rational& exact_point = static_cast<const Constant*>(at_point)->get_value();
+    std::vector<Rational> exact;
+    std::vector<const Expression*> coefficients;
+    if (exact_point.to_double() == point && TaylorSeries::exact_coefficients(f, variable_name, exact_point, order, exact)){
+        for (const Rational& coefficient : exact){
+            coefficients.push_back(ExpressionFactory::make_constant(coefficient));
+        }
+    }
+    else{
+        std::vector<double> approximate;
+        if (!TaylorSeries::coefficients(f, variable_name, point, order, approximate)){
+            return nullptr;
+        }
+        for (double coefficient : approximate){
+            if (!std::isfinite(coefficient)){
+                return nullptr;
+            }
+            coefficients.push_back(ExpressionFactory::make_constant(exact_rational(coefficient)));
+        }
+    }
+
+    // c_k (x - point)^k, leaving out zero terms and unit factors
+    const Expression* variable = ExpressionFactory::make_variable(variable_name);
+    const Expression* shifted = point == 0 ? variable
+        : ExpressionFactory::make_sum({variable, ExpressionFactory::make_constant(-exact_point)});
+    std::vector<const Expression*> terms;
+    for (size_t k = 0; k < coefficients.size(); ++k){
+        const Expression* coefficient = coefficients[k];
+        if (coefficient == Constant::ZERO){
+            continue;
+        }
+        if (k == 0){
+            terms.push_back(coefficient);
+            continue;
+        }
+        const Expression* power = k == 1 ? shifted : ExpressionFactory::make_power(shifted, ExpressionFactory::make_constant(static_cast<long long>(k)));
+        terms.push_back(coefficient == Constant::ONE ? power : ExpressionFactory::make_product({coefficient, power}));
+    }
+    if (terms.empty()){
+        return Constant::ZERO;
+    }
+    return terms.size() == 1 ? terms[0] : ExpressionFactory::make_sum(std::move(terms));
 }
 
 const Expression* NewtonMethod::Newton_root(const Expression* func, const std::string variable, double initial_guess = 1.0, double tolerance, int max_iterations) {
-    std::cout << "var: " << variable << "\n";
-    std::cout<< "expr: " << func->to_string() << " : " << hasVariables(func) << "\n";
-    Variable::variables[variable] = double_to_fraction(initial_guess); // Set initial guess
+    EvalContext context;
+    int slot = EvalContext::slot_of(variable);
+    context.set(slot, initial_guess); // Set initial guess
     for (int i = 0; i < max_iterations; ++i) {
-        double f_x = func->calculate();
-        const Expression* derivative = func->complex_derivative(variable);
-        std::cout << "der: " << derivative->to_string() << "\n";
-        double f_prime_x = derivative->calculate();
-        delete derivative; 
+        // f(x) and f'(x) in one pass, without building the derivative tree
+        Dual f = func->calculate_dual(context, slot);
+        double f_x = f.value;
+        double f_prime_x = f.derivative;
         if (std::abs(f_prime_x) < 1e-12) {
             return nullptr; 
         }
@@ -75,63 +294,137 @@ const Expression* NewtonMethod::Newton_root(const Expression* func, const std::s
             return double_to_fraction(new_guess);
         }
         initial_guess = new_guess;
-        Variable::variables[variable] = new Constant(initial_guess); 
+        context.set(slot, initial_guess);
     }
     return nullptr; 
 }
 
+bool NewtonMethod::Newton_system(const std::vector<const Expression*>& funcs, const std::vector<std::string>& variables,
+                                 std::vector<double>& solution, double tolerance, int max_iterations){
+    const size_t n = variables.size();
+    if (funcs.size() != n || solution.size() != n || n == 0){
+        return false;
+    }
+
+    // Compile every equation once; columns[i][k] is the unknown read by
+    // slot k of equation i, or -1 for variables that are not solved for.
+    std::vector<std::unique_ptr<CompiledExpression>> compiled;
+    std::vector<std::vector<int>> columns(n);
+    for (size_t i = 0; i < n; ++i){
+        compiled.push_back(std::make_unique<CompiledExpression>(funcs[i]));
+        for (const std::string& name : compiled[i]->variables()){
+            auto it = std::find(variables.begin(), variables.end(), name);
+            columns[i].push_back(it == variables.end() ? -1 : static_cast<int>(it - variables.begin()));
+        }
+    }
+
+    std::vector<double> values;
+    auto load = [&](size_t i, const std::vector<double>& x){
+        values.assign(columns[i].size(), 0);
+        for (size_t k = 0; k < columns[i].size(); ++k){
+            values[k] = columns[i][k] < 0 ? 0 : x[columns[i][k]];
+        }
+    };
+    auto residual = [&](const std::vector<double>& x){
+        std::vector<double> f(n);
+        for (size_t i = 0; i < n; ++i){
+            load(i, x);
+            f[i] = compiled[i]->calculate(values.data());
+        }
+        return f;
+    };
+
+    const size_t MAX_UPDATES = 2 * n + 10;
+    std::vector<double> x = solution;
+    std::vector<double> f = residual(x);
+    BroydenInverse inverse;
+    bool refresh = true;
+
+    for (int iteration = 0; iteration < max_iterations; ++iteration){
+        double norm = max_norm(f);
+        if (norm < tolerance){
+            solution = x;
+            return true;
+        }
+
+        if (refresh){
+            std::vector<double> jacobian(n * n, 0);
+            std::vector<double> gradient;
+            for (size_t i = 0; i < n; ++i){
+                load(i, x);
+                gradient.assign(columns[i].size(), 0);
+                compiled[i]->calculate_gradient(values.data(), gradient.data());
+                for (size_t k = 0; k < columns[i].size(); ++k){
+                    if (columns[i][k] >= 0){
+                        jacobian[i * n + columns[i][k]] += gradient[k];
+                    }
+                }
+            }
+            if (!inverse.lu.factor(std::move(jacobian), n)){
+                return false;
+            }
+            inverse.clear();
+            refresh = false;
+        }
+
+        std::vector<double> step = inverse.apply(f);
+        for (double& d : step){
+            d = -d;
+        }
+
+        // Backtracking line search on the residual norm
+        double t = 1;
+        std::vector<double> x_new(n);
+        std::vector<double> f_new;
+        bool accepted = false;
+        while (t > 1e-6){
+            for (size_t j = 0; j < n; ++j){
+                x_new[j] = x[j] + t * step[j];
+            }
+            f_new = residual(x_new);
+            if (max_norm(f_new) <= (1 - 1e-4 * t) * norm){
+                accepted = true;
+                break;
+            }
+            t /= 2;
+        }
+        if (!accepted){
+            if (inverse.size() == 0){
+                return false;
+            }
+            // The quasi-Newton direction went stale; retry with a fresh Jacobian
+            refresh = true;
+            continue;
+        }
+
+        std::vector<double> s(n);
+        std::vector<double> y(n);
+        for (size_t j = 0; j < n; ++j){
+            s[j] = x_new[j] - x[j];
+            y[j] = f_new[j] - f[j];
+        }
+        // Keep the factorization only while the residual at least halves
+        if (max_norm(f_new) > 0.5 * norm || inverse.size() >= MAX_UPDATES || !inverse.update(s, y)){
+            refresh = true;
+        }
+        x = std::move(x_new);
+        f = std::move(f_new);
+    }
+    if (max_norm(f) < tolerance){
+        solution = x;
+        return true;
+    }
+    return false;
+}
+
 bool hasVariables(const Expression* expr){
-    if (typeid(*expr) == typeid(Variable)){
-        std::cout << "hasVar - " << expr->to_string() << "  ";
+    if (expr->kind() == ExprKind::Variable){
         return true;
     }
-    else if (typeid(*expr) == typeid(operators::Sum)){
-        const operators::Sum* sumExpr = static_cast<const operators::Sum*>(expr);
-        for (const Expression* term : sumExpr->get_terms()){
-            if (hasVariables(term)){
-                return true;
-            }
-        }
-    }
-    else if (typeid(*expr) == typeid(operators::Product)){
-        const operators::Product* prodExpr = static_cast<const operators::Product*>(expr);
-        for (const Expression* factor : prodExpr->get_factors()){
-            if (hasVariables(factor)){
-                return true;
-            }
-        }
-    } 
-    else if (typeid(*expr) == typeid(operators::Fraction)){
-        const operators::Fraction* fracExpr = static_cast<const operators::Fraction*>(expr);
-        return hasVariables(fracExpr->get_dividend()) || hasVariables(fracExpr->get_divisor());
-    } 
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Power)){
-        const ElementaryFunctions::Power* powExpr = static_cast<const ElementaryFunctions::Power*>(expr);
-        return hasVariables(powExpr->get_input()) || hasVariables(powExpr->get_power());
-    } 
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Log)){
-        const ElementaryFunctions::Log* logExpr = static_cast<const ElementaryFunctions::Log*>(expr);
-        return hasVariables(logExpr->get_input()) || hasVariables(logExpr->get_base());
-    }
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Exp)){
-        const ElementaryFunctions::Exp* expExpr = static_cast<const ElementaryFunctions::Exp*>(expr);
-        return hasVariables(expExpr->get_input()) || hasVariables(expExpr->get_base());
-    } 
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Sin)){
-        const ElementaryFunctions::Sin* sinExpr = static_cast<const ElementaryFunctions::Sin*>(expr);
-        return hasVariables(sinExpr->get_input());
-    }
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Cos)){
-        const ElementaryFunctions::Cos* cosExpr = static_cast<const ElementaryFunctions::Cos*>(expr);
-        return hasVariables(cosExpr->get_input());
-    }
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Tan)){
-        const ElementaryFunctions::Tan* tanExpr = static_cast<const ElementaryFunctions::Tan*>(expr);
-        return hasVariables(tanExpr->get_input());
-    }
-    else if (typeid(*expr) == typeid(ElementaryFunctions::Cot)){
-        const ElementaryFunctions::Cot* cotExpr = static_cast<const ElementaryFunctions::Cot*>(expr);
-        return hasVariables(cotExpr->get_input());
+    for (const Expression* child : children(expr)){
+        if (hasVariables(child)){
+            return true;
+        }
     }
     return false;
 }
\ No newline at end of file
@@ -6,11 +6,20 @@
 class NewtonMethod{
 public:
     static const Expression* Newton_root(const Expression* func, const std::string variable, double initial_guess, double tolerance = 1e-6, int max_iterations = 100);
+
+    // Solves funcs[i] = 0 for the given variables, starting from solution
+    // (one value per variable) and leaving the root there. Damped Newton with
+    // the Jacobian from reverse-mode AD; its LU factorization is reused with
+    // Broyden updates while the residual keeps shrinking fast enough.
+    static bool Newton_system(const std::vector<const Expression*>& funcs, const std::vector<std::string>& variables,
+                              std::vector<double>& solution, double tolerance = 1e-10, int max_iterations = 100);
 };
 
 const Expression* double_to_fraction(double value);
 
-const Expression* Taylor_series(const Expression* f, const std::string& variable, double point);
+// Taylor polynomial of f around point up to (variable - point)^order, or null
+// if f is not analytic there
+const Expression* Taylor_series(const Expression* f, const std::string& variable, double point, size_t order = 4);
 
 bool hasVariables(const Expression* expr);
 
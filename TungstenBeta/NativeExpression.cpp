@@ -0,0 +1,223 @@
+#include "NativeExpression.h"
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace{
+    std::string hex(unsigned long long value){
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", value);
+        return buffer;
+    }
+
+    unsigned long long source_hash(const std::string& s){
+        unsigned long long h = 14695981039346656037ULL;
+        for (unsigned char c : s){
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    std::string c_literal(double value){
+        if (std::isnan(value)){
+            return "NAN";
+        }
+        if (std::isinf(value)){
+            return value > 0 ? "INFINITY" : "(-INFINITY)";
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+        return "(" + std::string(buffer) + ")";
+    }
+
+    std::string quote(const std::string& s){
+        std::string quoted = "'";
+        for (char c : s){
+            if (c == '\''){
+                quoted += "'\\''";
+            }
+            else{
+                quoted += c;
+            }
+        }
+        return quoted + "'";
+    }
+
+    // $CC may carry a launcher or flags ("ccache gcc", "gcc -m64"), so its
+    // words are quoted one by one, like make passes it to the shell
+    std::string compiler_command(){
+        const char* compiler = std::getenv("CC");
+        std::istringstream words(compiler ? compiler : "");
+        std::string command;
+        std::string word;
+        while (words >> word){
+            command += (command.empty() ? "" : " ") + quote(word);
+        }
+        return command.empty() ? "cc" : command;
+    }
+}
+
+std::string NativeExpression::to_c_source(const CompiledExpression& compiled){
+    using OpCode = CompiledExpression::OpCode;
+    const std::vector<CompiledExpression::Instruction>& tape = compiled.instructions();
+
+    std::ostringstream body;
+    for (size_t i = 0; i < tape.size(); ++i){
+        const CompiledExpression::Instruction& ins = tape[i];
+        std::string a = ins.lhs >= 0 ? "r" + std::to_string(ins.lhs) : "";
+        std::string b = ins.rhs >= 0 ? "r" + std::to_string(ins.rhs) : "";
+        std::string k = c_literal(ins.value);
+
+        body << "    const double r" << i << " = ";
+        switch (ins.op){
+            case OpCode::Const: body << k; break;
+            case OpCode::Var: body << "v[" << ins.lhs << "]"; break;
+            case OpCode::Add: body << a << " + " << b; break;
+            case OpCode::Mul: body << a << " * " << b; break;
+            case OpCode::Div: body << a << " / " << b; break;
+            case OpCode::Square: body << a << " * " << a; break;
+            case OpCode::Pow: body << "pow(" << a << ", " << b << ")"; break;
+            case OpCode::PowConst: body << "pow(" << a << ", " << k << ")"; break;
+            case OpCode::ExpConst: body << "exp(" << a << " * " << k << ")"; break;
+            case OpCode::Exp: body << "exp(" << b << " * log(" << a << "))"; break;
+            case OpCode::LogConst: body << "log(" << a << ") * " << k; break;
+            case OpCode::Log: body << "log(" << b << ") / log(" << a << ")"; break;
+            case OpCode::Sin: body << "sin(" << a << ")"; break;
+            case OpCode::Cos: body << "cos(" << a << ")"; break;
+            case OpCode::Tan: body << "tan(" << a << ")"; break;
+            case OpCode::Cot: body << "1.0 / tan(" << a << ")"; break;
+        }
+        body << ";\n";
+    }
+
+    size_t count = compiled.variables().size();
+    std::ostringstream source;
+    source << "#include <math.h>\n"
+           << "#include <stddef.h>\n\n"
+           << "static inline double eval(const double* v){\n"
+           << body.str()
+           << "    return r" << tape.size() - 1 << ";\n"
+           << "}\n\n"
+           << "double tungsten_eval(const double* v){\n"
+           << "    return eval(v);\n"
+           << "}\n\n"
+           << "void tungsten_eval_batch(const double* x, double* out, size_t n, int slot, const double* values){\n"
+           << "    double v[" << (count ? count : 1) << "] = {0};\n"
+           << "    for (size_t i = 0; i < " << count << "; ++i){\n"
+           << "        v[i] = values ? values[i] : 0.0;\n"
+           << "    }\n"
+           << "    for (size_t i = 0; i < n; ++i){\n"
+           << "        if (slot >= 0 && slot < " << count << "){\n"
+           << "            v[slot] = x[i];\n"
+           << "        }\n"
+           << "        out[i] = eval(v);\n"
+           << "    }\n"
+           << "}\n";
+    return source.str();
+}
+
+std::string NativeExpression::default_cache_directory(){
+    if (const char* dir = std::getenv("TUNGSTEN_CACHE_DIR")){
+        return dir;
+    }
+    if (const char* dir = std::getenv("XDG_CACHE_HOME")){
+        return std::string(dir) + "/tungsten";
+    }
+    if (const char* home = std::getenv("HOME")){
+        return std::string(home) + "/.cache/tungsten";
+    }
+    return (std::filesystem::temp_directory_path() / "tungsten").string();
+}
+
+NativeExpression::NativeExpression(const Expression* expr, const std::string& cache_directory) : compiled_(expr){
+    namespace fs = std::filesystem;
+
+    std::string source = to_c_source(compiled_);
+    // The structural hash names the entry, the source hash guards against
+    // collisions and changes of the generator.
+    std::string stem = "expr_" + hex(expr->hash()) + "_" + hex(source_hash(source));
+    fs::path directory = fs::path(cache_directory) / "native";
+    fs::path library = directory / (stem + ".so");
+
+    std::error_code error;
+    if (fs::exists(library, error) && load(library.string())){
+        return;
+    }
+
+    fs::create_directories(directory, error);
+    if (error){
+        return;
+    }
+
+    // Build under unique names and rename into place, so concurrent
+    // processes never load a half-written object.
+    std::string unique = stem + "." + std::to_string(getpid()) + "." + hex(reinterpret_cast<uintptr_t>(this));
+    fs::path source_path = directory / (unique + ".c");
+    fs::path temp_library = directory / (unique + ".so");
+    {
+        std::ofstream file(source_path);
+        file << source;
+        if (!file){
+            return;
+        }
+    }
+
+    std::string command = compiler_command() + " -O2 -shared -fPIC -o " + quote(temp_library.string())
+        + " " + quote(source_path.string()) + " -lm > /dev/null 2>&1";
+    int status = std::system(command.c_str());
+
+    fs::remove(source_path, error);
+    if (status == 0){
+        fs::rename(temp_library, library, error);
+        if (!error){
+            load(library.string());
+            return;
+        }
+    }
+    fs::remove(temp_library, error);
+}
+
+NativeExpression::~NativeExpression(){
+    if (library_ != nullptr){
+        dlclose(library_);
+    }
+}
+
+bool NativeExpression::load(const std::string& path){
+    library_ = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (library_ == nullptr){
+        return false;
+    }
+    eval_ = reinterpret_cast<EvalFunction>(dlsym(library_, "tungsten_eval"));
+    batch_ = reinterpret_cast<BatchFunction>(dlsym(library_, "tungsten_eval_batch"));
+    if (eval_ == nullptr || batch_ == nullptr){
+        dlclose(library_);
+        library_ = nullptr;
+        eval_ = nullptr;
+        batch_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+double NativeExpression::calculate(const double* values) const{
+    if (eval_ != nullptr){
+        return eval_(values);
+    }
+    return compiled_.calculate(values);
+}
+
+void NativeExpression::calculate_batch(const double* x, double* out, size_t count, int slot, const double* values) const{
+    if (batch_ != nullptr){
+        batch_(x, out, count, slot, values);
+        return;
+    }
+    compiled_.calculate_batch(x, out, count, slot, values);
+}
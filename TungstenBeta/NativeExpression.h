@@ -0,0 +1,46 @@
+#ifndef NATIVE_EXPRESSION_H
+#define NATIVE_EXPRESSION_H
+
+#include "Expression.h"
+#include "CompiledExpression.h"
+
+// Compiles an expression to machine code with the system C compiler. The
+// generated C source is built into a shared object, which is cached on disk
+// under the structural hash of the expression and loaded with dlopen. When no
+// compiler is available (or compilation fails) evaluation falls back to the
+// CompiledExpression interpreter, so the class works everywhere.
+class NativeExpression{
+public:
+    explicit NativeExpression(const Expression* expr, const std::string& cache_directory = default_cache_directory());
+    ~NativeExpression();
+
+    NativeExpression(const NativeExpression&) = delete;
+    NativeExpression& operator=(const NativeExpression&) = delete;
+
+    bool is_native() const { return eval_ != nullptr; }
+    const std::vector<std::string>& variables() const { return compiled_.variables(); }
+    int slot(const std::string& name) const { return compiled_.slot(name); }
+
+    // Same conventions as CompiledExpression
+    double calculate(const double* values) const;
+    void calculate_batch(const double* x, double* out, size_t count, int slot = 0, const double* values = nullptr) const;
+
+    // C source of a translation unit exporting tungsten_eval and tungsten_eval_batch
+    static std::string to_c_source(const CompiledExpression& compiled);
+
+    // $TUNGSTEN_CACHE_DIR, else $XDG_CACHE_HOME/tungsten, else ~/.cache/tungsten
+    static std::string default_cache_directory();
+
+private:
+    typedef double (*EvalFunction)(const double*);
+    typedef void (*BatchFunction)(const double*, double*, size_t, int, const double*);
+
+    CompiledExpression compiled_;
+    void* library_ = nullptr;
+    EvalFunction eval_ = nullptr;
+    BatchFunction batch_ = nullptr;
+
+    bool load(const std::string& path);
+};
+
+#endif // NATIVE_EXPRESSION_H
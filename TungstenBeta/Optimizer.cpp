@@ -0,0 +1,219 @@
+#include "Optimizer.h"
+#include "ExpressionFactory.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+namespace{
+    const double INF = std::numeric_limits<double>::infinity();
+
+    // Minimization state shared by the worker threads. Expression nodes are
+    // immutable, so the threads only need their own EvalContext.
+    class Search{
+    public:
+        Search(const Expression* func, const Expression* derivative, int slot, double lo, double hi, double tolerance, size_t max_boxes)
+            : func_(func), derivative_(derivative), slot_(slot), lo_(lo), hi_(hi), tolerance_(tolerance), max_boxes_(max_boxes) {}
+
+        double value_at(EvalContext& context, double x) const{
+            context.set(slot_, x);
+            return func_->calculate(context);
+        }
+
+        // Records a candidate point; NaN values never win
+        void offer(double x, double value){
+            if (!(value < upper_.load(std::memory_order_relaxed))){
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (value < best_value_){
+                best_value_ = value;
+                best_argument_ = x;
+                upper_.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        // Lower bound of a region that was not refined any further
+        void lower(double bound){
+            std::lock_guard<std::mutex> lock(mutex_);
+            lower_ = std::min(lower_, bound);
+        }
+
+        // Descent from x: Newton on the derivative where the function is
+        // convex, a gradient step otherwise, with backtracking and clamping
+        // to [lo, hi]
+        void refine(EvalContext& context, double x){
+            double fx = value_at(context, x);
+            for (int i = 0; i < 50 && std::isfinite(fx); ++i){
+                context.set(slot_, x);
+                Dual slope = derivative_->calculate_dual(context, slot_);
+                if (!std::isfinite(slope.value) || slope.value == 0){
+                    break;
+                }
+                double step = slope.derivative > 0 ? -slope.value / slope.derivative : -slope.value;
+                double scale = 1;
+                bool moved = false;
+                for (int k = 0; k < 40; ++k){
+                    double next = std::min(std::max(x + scale * step, lo_), hi_);
+                    double value = value_at(context, next);
+                    if (value <= fx){
+                        moved = next != x;
+                        x = next;
+                        fx = value;
+                        break;
+                    }
+                    scale *= 0.5;
+                }
+                if (!moved || std::fabs(scale * step) <= tolerance_ * std::max(1.0, std::fabs(x))){
+                    break;
+                }
+            }
+            offer(x, fx);
+        }
+
+        // Depth-first interval branch and bound on one box
+        void branch(EvalContext& context, Interval root){
+            std::vector<Interval> stack = {root};
+            while (!stack.empty()){
+                Interval box = stack.back();
+                stack.pop_back();
+                Interval range = func_->calculate_interval(context, slot_, box);
+                if (range.is_empty() || range.lo > upper_.load(std::memory_order_relaxed)){
+                    continue;
+                }
+                if (boxes_.fetch_add(1, std::memory_order_relaxed) >= max_boxes_){
+                    // Out of budget: what is left only widens the certificate
+                    lower(range.lo);
+                    continue;
+                }
+
+                double mid = box.midpoint();
+                offer(mid, value_at(context, mid));
+                double upper = upper_.load(std::memory_order_relaxed);
+                if (range.lo >= upper - tolerance_ * std::max(1.0, std::fabs(upper))){
+                    lower(range.lo);
+                    continue;
+                }
+                // Monotone on the box: its minimum is on an edge, and every
+                // edge is a domain endpoint or shared with another box. Only
+                // trusted when both enclosures are finite; poles and domain
+                // edges (1/x, sqrt x at 0) make one of them infinite.
+                Interval slope = derivative_->calculate_interval(context, slot_, box);
+                if (std::isfinite(range.lo) && std::isfinite(range.hi) && std::isfinite(slope.lo) && std::isfinite(slope.hi)
+                    && !slope.contains(0)){
+                    continue;
+                }
+                if (box.width() <= tolerance_ * std::max(1.0, std::fabs(mid))){
+                    lower(range.lo);
+                    continue;
+                }
+                stack.push_back(Interval{mid, box.hi});
+                stack.push_back(Interval{box.lo, mid});
+            }
+        }
+
+        double best_argument() const { return best_argument_; }
+        double best_value() const { return best_value_; }
+        double lower_bound() const { return lower_; }
+        size_t boxes() const { return std::min(boxes_.load(), max_boxes_); }
+
+    private:
+        const Expression* func_;
+        const Expression* derivative_;
+        int slot_;
+        double lo_;
+        double hi_;
+        double tolerance_;
+        size_t max_boxes_;
+
+        std::mutex mutex_;
+        std::atomic<double> upper_{INF};
+        std::atomic<size_t> boxes_{0};
+        double best_value_ = INF;
+        double best_argument_ = 0;
+        double lower_ = INF;
+    };
+}
+
+Extremum GlobalOptimizer::find_minimum(const Expression* func, const std::string& variable, double lo, double hi,
+                                       double tolerance, size_t max_boxes){
+    Extremum result;
+    if (!(lo <= hi) || !std::isfinite(lo) || !std::isfinite(hi)){
+        return result;
+    }
+
+    // Built here, in the caller's arena; the threads only evaluate
+    const Expression* derivative = func->complex_derivative(variable);
+    int slot = EvalContext::slot_of(variable);
+    Search search(func, derivative, slot, lo, hi, tolerance, max_boxes);
+
+    EvalContext context;
+    search.offer(lo, search.value_at(context, lo));
+    search.offer(hi, search.value_at(context, hi));
+    search.lower(func->calculate_interval(context, slot, Interval::point(lo)).lo);
+    search.lower(func->calculate_interval(context, slot, Interval::point(hi)).lo);
+
+    // Phase 1: multi-start local refinement for a tight incumbent
+    size_t workers = parallel_workers();
+    size_t starts = 8 * workers;
+    double width = hi - lo;
+    parallel_for(starts, [&](EvalContext& local, size_t i){
+        search.refine(local, lo + (i + 0.5) * width / starts);
+    });
+
+    // Phase 2: branch and bound over equal slices of [lo, hi]
+    size_t slices = lo < hi ? 8 * workers : 1;
+    parallel_for(slices, [&](EvalContext& local, size_t i){
+        double a = lo + width * i / slices;
+        double b = i + 1 == slices ? hi : lo + width * (i + 1) / slices;
+        search.branch(local, Interval{a, b});
+    });
+
+    double x = search.best_argument();
+    if (x != lo && x != hi){
+        search.refine(context, x);
+        x = search.best_argument();
+    }
+    result.value = search.best_value();
+    result.argument = x;
+    result.found = std::isfinite(result.value);
+    result.boxes = search.boxes();
+
+    // The computed value is rounded; its enclosure bounds the true minimum
+    Interval at_best = func->calculate_interval(context, slot, Interval::point(x));
+    if (at_best.is_empty()){
+        at_best = Interval::point(result.value);
+    }
+    result.bound = Interval{std::min(search.lower_bound(), at_best.lo), at_best.hi};
+
+    context.set(slot, x);
+    result.second_derivative = derivative->calculate_dual(context, slot).derivative;
+    double edge = tolerance * std::max(1.0, std::fabs(x));
+    if (std::fabs(x - lo) > edge && std::fabs(x - hi) > edge){
+        double flat = 1e-8 * std::max(1.0, std::fabs(result.value));
+        if (std::fabs(result.second_derivative) <= flat){
+            result.kind = Extremum::Kind::Flat;
+        }
+        else{
+            result.kind = result.second_derivative > 0 ? Extremum::Kind::Minimum : Extremum::Kind::Maximum;
+        }
+    }
+    return result;
+}
+
+Extremum GlobalOptimizer::find_maximum(const Expression* func, const std::string& variable, double lo, double hi,
+                                       double tolerance, size_t max_boxes){
+    const Expression* negated = ExpressionFactory::make_product({ExpressionFactory::make_constant(-1), func});
+    Extremum result = find_minimum(negated, variable, lo, hi, tolerance, max_boxes);
+    result.value = 0.0 - result.value;
+    result.bound = -result.bound;
+    result.second_derivative = -result.second_derivative;
+    if (result.kind == Extremum::Kind::Minimum){
+        result.kind = Extremum::Kind::Maximum;
+    }
+    else if (result.kind == Extremum::Kind::Maximum){
+        result.kind = Extremum::Kind::Minimum;
+    }
+    return result;
+}
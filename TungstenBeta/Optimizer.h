@@ -0,0 +1,37 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "Expression.h"
+
+// Result of a global extremum search over [lo, hi]
+struct Extremum{
+    // Second derivative test at the argument; Endpoint when it is lo or hi
+    enum class Kind{ Endpoint, Minimum, Maximum, Flat };
+
+    bool found = false;
+    double argument = 0;
+    double value = 0;
+    // Certificate: the true global extremum lies in [bound.lo, bound.hi].
+    // It is only as wide as the tolerance unless the box budget ran out.
+    Interval bound{0, 0};
+    Kind kind = Kind::Endpoint;
+    double second_derivative = 0;
+    // Boxes examined by branch and bound
+    size_t boxes = 0;
+};
+
+// Global extrema of a one-variable expression on a closed interval. Local
+// Newton refinement on the derivative from many starting points gives a good
+// incumbent quickly; interval branch and bound then discards every box whose
+// enclosure lies above it or on which the derivative cannot vanish, which
+// proves the result. Both phases run on all cores. Other variables of func
+// are treated as 0.
+class GlobalOptimizer{
+public:
+    static Extremum find_minimum(const Expression* func, const std::string& variable, double lo, double hi,
+                                 double tolerance = 1e-9, size_t max_boxes = 1000000);
+    static Extremum find_maximum(const Expression* func, const std::string& variable, double lo, double hi,
+                                 double tolerance = 1e-9, size_t max_boxes = 1000000);
+};
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,65 @@
+#include "Parallel.h"
+
+ThreadPool::ThreadPool(size_t threads){
+    for (size_t worker = 1; worker < std::max<size_t>(threads, 1); ++worker){
+        threads_.emplace_back([this, worker](){ run(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& thread : threads_){
+        thread.join();
+    }
+}
+
+void ThreadPool::for_each(size_t count, const std::function<void(size_t, size_t)>& task){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_.store(0);
+        busy_ = threads_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this](){ return busy_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::run(size_t worker){
+    in_parallel_worker = true;
+    size_t seen = 0;
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [&](){ return stopping_ || generation_ != seen; });
+            if (stopping_){
+                return;
+            }
+            seen = generation_;
+        }
+        work(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::work(size_t worker){
+    bool nested = in_parallel_worker;
+    in_parallel_worker = true;
+    for (size_t i = next_++; i < count_; i = next_++){
+        (*task_)(worker, i);
+    }
+    in_parallel_worker = nested;
+}
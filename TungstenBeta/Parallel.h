@@ -0,0 +1,84 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "EvalContext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of worker threads used by the parallel solvers
+inline size_t parallel_workers(){
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Set on threads that already run one share of a parallel loop. Loops
+// started from there run serially, so solvers called per item of a batch
+// do not multiply the thread count.
+inline thread_local bool in_parallel_worker = false;
+
+// Runs task(context, i) for every i in [0, count) on all cores. Each worker
+// owns an EvalContext, which is all evaluation needs: expression nodes are
+// immutable, so they can be shared freely once built.
+template <typename Task>
+void parallel_for(size_t count, Task task){
+    size_t threads = in_parallel_worker ? 1 : std::min(parallel_workers(), count);
+    std::atomic<size_t> next{0};
+    auto worker = [&](){
+        bool nested = in_parallel_worker;
+        in_parallel_worker = true;
+        EvalContext context;
+        for (size_t i = next++; i < count; i = next++){
+            task(context, i);
+        }
+        in_parallel_worker = nested;
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t){
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool){
+        thread.join();
+    }
+}
+
+// Long-lived workers for many short parallel loops, such as the batches of
+// a stream, where starting threads per loop would cost more than the work.
+// Workers are numbered so callers can keep per-worker state (an arena, an
+// EvalContext) across loops; the calling thread is worker 0.
+class ThreadPool{
+public:
+    explicit ThreadPool(size_t threads = parallel_workers());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads_.size() + 1; }
+
+    // Runs task(worker, i) for every i in [0, count) and waits for all of them
+    void for_each(size_t count, const std::function<void(size_t worker, size_t i)>& task);
+
+private:
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(size_t, size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    // Bumped per loop, so a worker never runs the same loop twice
+    size_t generation_ = 0;
+    size_t busy_ = 0;
+    bool stopping_ = false;
+
+    void run(size_t worker);
+    void work(size_t worker);
+};
+
+#endif // PARALLEL_H
@@ -0,0 +1,392 @@
+#include "Parser.h"
+#include "Constant.h"
+#include "ExpressionFactory.h"
+
+namespace{
+    enum class TokenKind{
+        Number, Identifier, Plus, Minus, Star, Slash, Caret, LeftParen, RightParen, Comma, End
+    };
+
+    struct Token{
+        TokenKind kind;
+        std::string_view text;
+        size_t position;
+    };
+
+    bool is_digit(char c){
+        return c >= '0' && c <= '9';
+    }
+
+    bool is_identifier_start(char c){
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    class Lexer{
+    public:
+        explicit Lexer(std::string_view input) : input_(input) {}
+
+        Token next(){
+            while (position_ < input_.size() && (input_[position_] == ' ' || input_[position_] == '\t'
+                                                 || input_[position_] == '\n' || input_[position_] == '\r')){
+                ++position_;
+            }
+            size_t start = position_;
+            if (position_ == input_.size()){
+                return Token{TokenKind::End, input_.substr(start, 0), start};
+            }
+
+            char c = input_[position_];
+            if (is_digit(c) || (c == '.' && position_ + 1 < input_.size() && is_digit(input_[position_ + 1]))){
+                skip_digits();
+                if (position_ < input_.size() && input_[position_] == '.'){
+                    ++position_;
+                    skip_digits();
+                }
+                // An exponent needs digits, so 2e is still 2 times e
+                if (position_ < input_.size() && (input_[position_] == 'e' || input_[position_] == 'E')){
+                    size_t digits = position_ + 1;
+                    if (digits < input_.size() && (input_[digits] == '+' || input_[digits] == '-')){
+                        ++digits;
+                    }
+                    if (digits < input_.size() && is_digit(input_[digits])){
+                        position_ = digits;
+                        skip_digits();
+                    }
+                }
+                return Token{TokenKind::Number, input_.substr(start, position_ - start), start};
+            }
+            if (is_identifier_start(c)){
+                while (position_ < input_.size() && (is_identifier_start(input_[position_]) || is_digit(input_[position_]))){
+                    ++position_;
+                }
+                return Token{TokenKind::Identifier, input_.substr(start, position_ - start), start};
+            }
+
+            ++position_;
+            switch (c){
+                case '+': return Token{TokenKind::Plus, input_.substr(start, 1), start};
+                case '-': return Token{TokenKind::Minus, input_.substr(start, 1), start};
+                case '*': return Token{TokenKind::Star, input_.substr(start, 1), start};
+                case '/': return Token{TokenKind::Slash, input_.substr(start, 1), start};
+                case '^': return Token{TokenKind::Caret, input_.substr(start, 1), start};
+                case '(': return Token{TokenKind::LeftParen, input_.substr(start, 1), start};
+                case ')': return Token{TokenKind::RightParen, input_.substr(start, 1), start};
+                case ',': return Token{TokenKind::Comma, input_.substr(start, 1), start};
+            }
+            throw ParseError(start, "unexpected character '" + std::string(1, c) + "'");
+        }
+
+    private:
+        std::string_view input_;
+        size_t position_ = 0;
+
+        void skip_digits(){
+            while (position_ < input_.size() && is_digit(input_[position_])){
+                ++position_;
+            }
+        }
+    };
+
+    // Exact value of a decimal literal: digits / 10^fraction_digits * 10^exponent
+    Rational number_value(const Token& token){
+        const long long MAX_EXPONENT = 4096;
+        std::string_view text = token.text;
+        BigInt digits = 0;
+        long long chunk = 0;
+        long long chunk_scale = 1;
+        long long exponent = 0;
+        bool fraction = false;
+        size_t i = 0;
+        for (; i < text.size() && text[i] != 'e' && text[i] != 'E'; ++i){
+            if (text[i] == '.'){
+                fraction = true;
+                continue;
+            }
+            chunk = chunk * 10 + (text[i] - '0');
+            chunk_scale *= 10;
+            exponent -= fraction ? 1 : 0;
+            // 18 digits always fit into a long long
+            if (chunk_scale == 1000000000000000000LL){
+                digits = digits * BigInt(chunk_scale) + BigInt(chunk);
+                chunk = 0;
+                chunk_scale = 1;
+            }
+        }
+        digits = digits * BigInt(chunk_scale) + BigInt(chunk);
+        if (i < text.size()){
+            bool negative = text[++i] == '-';
+            if (text[i] == '+' || text[i] == '-'){
+                ++i;
+            }
+            long long written = 0;
+            for (; i < text.size(); ++i){
+                written = std::min(written * 10 + (text[i] - '0'), 2 * MAX_EXPONENT);
+            }
+            exponent += negative ? -written : written;
+        }
+        if (exponent > MAX_EXPONENT || exponent < -MAX_EXPONENT){
+            throw ParseError(token.position, "exponent of '" + std::string(text) + "' is too large");
+        }
+
+        BigInt scale = 1;
+        BigInt ten = 10;
+        for (long long k = 0; k < (exponent < 0 ? -exponent : exponent); ++k){
+            scale = scale * ten;
+        }
+        return exponent < 0 ? Rational(digits, scale) : Rational(digits * scale, BigInt(1));
+    }
+
+    // A parsed node and whether it contains a variable, found while building
+    // it, so ^ does not have to walk its operands
+    struct Operand{
+        const Expression* expr;
+        bool varying;
+    };
+
+    class ExpressionParser{
+    public:
+        explicit ExpressionParser(std::string_view input) : lexer_(input) {
+            advance();
+        }
+
+        const Expression* parse(){
+            Operand result = parse_sum();
+            if (token_.kind != TokenKind::End){
+                throw ParseError(token_.position, "unexpected '" + std::string(token_.text) + "'");
+            }
+            return result.expr;
+        }
+
+    private:
+        // Deeper nesting would overflow the stack here or in later traversals
+        static const int MAX_DEPTH = 1000;
+
+        Lexer lexer_;
+        Token token_;
+        int depth_ = 0;
+        // Variables by name, so repeated occurrences skip the string copy
+        std::unordered_map<std::string_view, const Expression*> variables_;
+
+        void advance(){
+            token_ = lexer_.next();
+        }
+
+        void expect(TokenKind kind, const char* what){
+            if (token_.kind != kind){
+                throw ParseError(token_.position, std::string("expected ") + what + describe_found());
+            }
+            advance();
+        }
+
+        std::string describe_found() const{
+            if (token_.kind == TokenKind::End){
+                return " at the end of the input";
+            }
+            return " before '" + std::string(token_.text) + "'";
+        }
+
+        static Operand negate(Operand operand){
+            const Expression* expr = operand.expr;
+            if (expr->kind() == ExprKind::Constant && expr != Constant::e && expr != Constant::pi){
+                return Operand{ExpressionFactory::make_constant(-static_cast<const Constant*>(expr)->get_value()), false};
+            }
+            return Operand{ExpressionFactory::make_product({ExpressionFactory::make_constant(-1), expr}), operand.varying};
+        }
+
+        bool starts_operand() const{
+            return token_.kind == TokenKind::Number || token_.kind == TokenKind::Identifier || token_.kind == TokenKind::LeftParen;
+        }
+
+        // Terms of a chain of + and - become one n-ary sum, so long inputs
+        // give a flat node instead of a deep binary tree
+        static void add(std::vector<const Expression*>& list, Operand operand, bool& varying){
+            varying = varying || operand.varying;
+            list.push_back(operand.expr);
+        }
+
+        Operand parse_sum(){
+            std::vector<const Expression*> terms;
+            bool varying = false;
+            add(terms, parse_product(), varying);
+            while (token_.kind == TokenKind::Plus || token_.kind == TokenKind::Minus){
+                bool minus = token_.kind == TokenKind::Minus;
+                advance();
+                Operand term = parse_product();
+                add(terms, minus ? negate(term) : term, varying);
+            }
+            return Operand{terms.size() == 1 ? terms[0] : ExpressionFactory::make_sum(std::move(terms)), varying};
+        }
+
+        Operand parse_product(){
+            std::vector<const Expression*> factors;
+            bool varying = false;
+            add(factors, parse_unary(), varying);
+            while (true){
+                if (token_.kind == TokenKind::Star){
+                    advance();
+                    add(factors, parse_unary(), varying);
+                }
+                else if (token_.kind == TokenKind::Slash){
+                    // Left associative: a / b * c is (a / b) * c
+                    advance();
+                    const Expression* dividend = factors.size() == 1 ? factors[0] : ExpressionFactory::make_product(std::move(factors));
+                    Operand divisor = parse_unary();
+                    varying = varying || divisor.varying;
+                    factors = {ExpressionFactory::make_fraction(dividend, divisor.expr)};
+                }
+                else if (starts_operand()){
+                    add(factors, parse_unary(), varying);
+                }
+                else{
+                    break;
+                }
+            }
+            return Operand{factors.size() == 1 ? factors[0] : ExpressionFactory::make_product(std::move(factors)), varying};
+        }
+
+        // Every recursion passes through here, so this bounds the depth
+        Operand parse_unary(){
+            if (++depth_ > MAX_DEPTH){
+                throw ParseError(token_.position, "expression is nested too deeply");
+            }
+            Operand result;
+            if (token_.kind == TokenKind::Minus){
+                advance();
+                result = negate(parse_unary());
+            }
+            else if (token_.kind == TokenKind::Plus){
+                advance();
+                result = parse_unary();
+            }
+            else{
+                result = parse_power();
+            }
+            --depth_;
+            return result;
+        }
+
+        Operand parse_power(){
+            Operand base = parse_primary();
+            if (token_.kind != TokenKind::Caret){
+                return base;
+            }
+            advance();
+            Operand power = parse_unary();
+            bool varying = base.varying || power.varying;
+            if (!power.varying){
+                return Operand{ExpressionFactory::make_power(base.expr, power.expr), varying};
+            }
+            if (!base.varying){
+                return Operand{ExpressionFactory::make_exp(base.expr, power.expr), varying};
+            }
+            // f^g with both varying is e^(g ln f)
+            return Operand{ExpressionFactory::make_exp(Constant::e,
+                ExpressionFactory::make_product({power.expr, ExpressionFactory::make_log(Constant::e, base.expr)})), true};
+        }
+
+        Operand parse_primary(){
+            Token token = token_;
+            switch (token.kind){
+                case TokenKind::Number:{
+                    advance();
+                    // Plain integers of up to 18 digits skip the exact conversion
+                    if (token.text.size() <= 18 && token.text.find_first_not_of("0123456789") == std::string_view::npos){
+                        long long value = 0;
+                        for (char c : token.text){
+                            value = value * 10 + (c - '0');
+                        }
+                        return Operand{ExpressionFactory::make_constant(value), false};
+                    }
+                    return Operand{ExpressionFactory::make_constant(number_value(token)), false};
+                }
+                case TokenKind::LeftParen:{
+                    advance();
+                    Operand inner = parse_sum();
+                    expect(TokenKind::RightParen, "')'");
+                    return inner;
+                }
+                case TokenKind::Identifier:
+                    advance();
+                    return parse_identifier(token);
+                case TokenKind::End:
+                    throw ParseError(token.position, "expected an operand at the end of the input");
+                default:
+                    throw ParseError(token.position, "expected an operand before '" + std::string(token.text) + "'");
+            }
+        }
+
+        Operand parse_identifier(const Token& name){
+            if (name.text == "e"){
+                return Operand{Constant::e, false};
+            }
+            if (name.text == "pi"){
+                return Operand{Constant::pi, false};
+            }
+            bool function = name.text == "sin" || name.text == "cos" || name.text == "tan" || name.text == "cot"
+                || name.text == "sqrt" || name.text == "exp" || name.text == "ln" || name.text == "lg" || name.text == "log";
+            if (!function){
+                auto it = variables_.find(name.text);
+                if (it == variables_.end()){
+                    it = variables_.emplace(name.text, ExpressionFactory::make_variable(std::string(name.text))).first;
+                }
+                return Operand{it->second, true};
+            }
+
+            std::vector<const Expression*> args;
+            bool varying = false;
+            if (token_.kind == TokenKind::LeftParen){
+                advance();
+                add(args, parse_sum(), varying);
+                while (token_.kind == TokenKind::Comma){
+                    advance();
+                    add(args, parse_sum(), varying);
+                }
+                expect(TokenKind::RightParen, "')'");
+            }
+            else if (starts_operand() || token_.kind == TokenKind::Minus || token_.kind == TokenKind::Plus){
+                // sin x^2 is sin(x^2)
+                add(args, parse_unary(), varying);
+            }
+            else{
+                throw ParseError(token_.position, "expected an argument of '" + std::string(name.text) + "'" + describe_found());
+            }
+
+            size_t arity = name.text == "log" ? args.size() : 1;
+            if (args.size() != arity || arity > 2){
+                throw ParseError(name.position, "wrong number of arguments for '" + std::string(name.text) + "'");
+            }
+            const Expression* arg = args.back();
+            if (name.text == "sin"){
+                return Operand{ExpressionFactory::make_sin(arg), varying};
+            }
+            if (name.text == "cos"){
+                return Operand{ExpressionFactory::make_cos(arg), varying};
+            }
+            if (name.text == "tan"){
+                return Operand{ExpressionFactory::make_tan(arg), varying};
+            }
+            if (name.text == "cot"){
+                return Operand{ExpressionFactory::make_cot(arg), varying};
+            }
+            if (name.text == "sqrt"){
+                return Operand{ExpressionFactory::make_power(arg, ExpressionFactory::make_constant(Rational(1, 2))), varying};
+            }
+            if (name.text == "exp"){
+                return Operand{ExpressionFactory::make_exp(Constant::e, arg), varying};
+            }
+            if (name.text == "lg"){
+                return Operand{ExpressionFactory::make_log(ExpressionFactory::make_constant(10), arg), varying};
+            }
+            // ln, log(x) and log(base, x)
+            return Operand{ExpressionFactory::make_log(args.size() == 2 ? args[0] : Constant::e, arg), varying};
+        }
+    };
+}
+
+ParseError::ParseError(size_t position, const std::string& message)
+    : std::invalid_argument(message + " (column " + std::to_string(position + 1) + ")"), position_(position) {}
+
+const Expression* Parser::parse(std::string_view input){
+    ExpressionParser parser(input);
+    return parser.parse();
+}
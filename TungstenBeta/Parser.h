@@ -0,0 +1,38 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "Expression.h"
+
+#include <stdexcept>
+#include <string_view>
+
+// Syntax error with the offset of the offending character in the input
+class ParseError : public std::invalid_argument{
+public:
+    ParseError(size_t position, const std::string& message);
+    size_t position() const { return position_; }
+
+private:
+    size_t position_;
+};
+
+// Single pass parser from text to expression nodes. Tokens are views into
+// the input and nodes are built while parsing, without an intermediate
+// token list or RPN queue.
+//
+// Grammar, loosest binding first:
+//     sum      = product {("+" | "-") product}
+//     product  = unary {("*" | "/") unary | unary}      juxtaposition: 2x, 2(x + 1)
+//     unary    = ("+" | "-") unary | power
+//     power    = primary ["^" unary]                    right associative: -x^2 = -(x^2)
+//     primary  = number | "e" | "pi" | variable | "(" sum ")"
+//              | function "(" sum {"," sum} ")" | function unary
+// Numbers may have a fraction and an exponent (2.5, 1e-3) and are exact.
+// Functions: sin cos tan cot sqrt exp ln lg log(x) log(base, x).
+class Parser{
+public:
+    // Throws ParseError
+    static const Expression* parse(std::string_view input);
+};
+
+#endif // PARSER_H
@@ -0,0 +1,464 @@
+#include "Polynomial.h"
+#include "Constant.h"
+#include "ExpressionFactory.h"
+#include "ExpressionVisitor.h"
+
+#include <numeric>
+
+namespace{
+    const uint64_t EXPONENT_OVERFLOW = 0x8000800080008000ULL;
+    const unsigned MAX_POWER = 64;
+
+    bool is_exact_constant(const Expression* expr){
+        return (expr->kind() == ExprKind::Constant) && (expr != Constant::e) && (expr != Constant::pi);
+    }
+
+    // Value of a variable-free tree of integers, sums, products and fractions
+    bool exact_value(const Expression* expr, Rational& value){
+        switch (expr->kind()){
+            case ExprKind::Constant:
+                if (!is_exact_constant(expr)){
+                    return false;
+                }
+                value = static_cast<const Constant*>(expr)->get_value();
+                return true;
+            case ExprKind::Sum:
+            case ExprKind::Product:{
+                bool sum = expr->kind() == ExprKind::Sum;
+                value = Rational(sum ? 0 : 1);
+                for (const Expression* child : children(expr)){
+                    Rational operand;
+                    if (!exact_value(child, operand)){
+                        return false;
+                    }
+                    value = sum ? value + operand : value * operand;
+                }
+                return true;
+            }
+            case ExprKind::Fraction:{
+                Rational dividend;
+                Rational divisor;
+                const operators::Fraction* fraction = static_cast<const operators::Fraction*>(expr);
+                if (!exact_value(fraction->get_dividend(), dividend) || !exact_value(fraction->get_divisor(), divisor) || divisor.is_zero()){
+                    return false;
+                }
+                value = dividend / divisor;
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Non-negative integer exponent of a power node
+    bool integer_exponent(const ElementaryFunctions::Power* power, unsigned& exponent){
+        Rational value;
+        if (!exact_value(power->get_power(), value) || !value.is_integer() || value.numerator() < 0 || value.numerator() > MAX_POWER){
+            return false;
+        }
+        exponent = static_cast<unsigned>(value.numerator());
+        return true;
+    }
+
+}
+
+// Walks a subtree twice: once to find and order its atoms, once to convert
+// it over them. Sums below the root are replaced by their simplified form,
+// which is either already expanded or marked not_polynomial(); collecting
+// stops at the first marked node, converting at the first result past the
+// limits.
+class PolynomialBuilder{
+public:
+    PolynomialBuilder(const Expression* root, size_t max_terms) : root_(root), max_terms_(max_terms) {}
+
+    bool build(Polynomial& result){
+        if (!collect(root_)){
+            return false;
+        }
+        finish_atoms();
+        return convert(root_, result);
+    }
+
+private:
+    const Expression* root_;
+    size_t max_terms_;
+    std::vector<const Expression*> atoms_;
+    std::unordered_map<const Expression*, size_t, ExpressionHash, ExpressionEqual> index_;
+    std::shared_ptr<const std::vector<const Expression*>> shared_;
+
+    bool fits(const Polynomial& polynomial) const{
+        return polynomial.valid() && polynomial.size() <= max_terms_;
+    }
+
+    bool collect(const Expression* expr){
+        if (expr->not_polynomial()){
+            return false;
+        }
+        // Only constant leaves are tested: sums, products and fractions of
+        // constants fold through the arithmetic, and testing whole subtrees
+        // would walk them again from every node
+        if (is_exact_constant(expr)){
+            return true;
+        }
+        Rational value;
+        switch (expr->kind()){
+            case ExprKind::Sum:
+                if (expr != root_){
+                    const Expression* simplified = expr->simplify();
+                    if (simplified != expr){
+                        return collect(simplified);
+                    }
+                }
+                // fall through
+            case ExprKind::Product:
+                for (const Expression* child : children(expr)){
+                    if (!collect(child)){
+                        return false;
+                    }
+                }
+                return true;
+            case ExprKind::Fraction:{
+                const operators::Fraction* fraction = static_cast<const operators::Fraction*>(expr);
+                if (exact_value(fraction->get_divisor(), value) && !value.is_zero()){
+                    return collect(fraction->get_dividend());
+                }
+                break;
+            }
+            case ExprKind::Power:{
+                unsigned exponent;
+                if (integer_exponent(static_cast<const ElementaryFunctions::Power*>(expr), exponent)){
+                    return collect(static_cast<const ElementaryFunctions::Power*>(expr)->get_base());
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        const Expression* simplified = expr->simplify();
+        if (simplified != expr){
+            return collect(simplified);
+        }
+        if (index_.emplace(expr, 0).second){
+            atoms_.push_back(expr);
+        }
+        return true;
+    }
+
+    // Fixes the atom order; call after collecting and before converting
+    void finish_atoms(){
+        std::sort(atoms_.begin(), atoms_.end(), canonical_less);
+        for (size_t i = 0; i < atoms_.size(); ++i){
+            index_[atoms_[i]] = i;
+        }
+        shared_ = std::make_shared<const std::vector<const Expression*>>(atoms_);
+    }
+
+    // A node that cannot be converted is marked, so no larger sum expands
+    // it again
+    bool convert(const Expression* expr, Polynomial& result){
+        if (!convert_node(expr, result)){
+            expr->mark_not_polynomial();
+            return false;
+        }
+        return true;
+    }
+
+    bool convert_node(const Expression* expr, Polynomial& result){
+        if (is_exact_constant(expr)){
+            result = Polynomial::constant(shared_, static_cast<const Constant*>(expr)->get_value());
+            return result.valid();
+        }
+        Rational value;
+        switch (expr->kind()){
+            case ExprKind::Sum:
+                if (expr != root_){
+                    const Expression* simplified = expr->simplify();
+                    if (simplified != expr){
+                        return convert(simplified, result);
+                    }
+                }
+                // fall through
+            case ExprKind::Product:{
+                bool sum = expr->kind() == ExprKind::Sum;
+                result = Polynomial::constant(shared_, Rational(sum ? 0 : 1));
+                for (const Expression* child : children(expr)){
+                    Polynomial operand;
+                    if (!convert(child, operand)){
+                        return false;
+                    }
+                    result = sum ? result + operand : result * operand;
+                    if (!fits(result)){
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExprKind::Fraction:{
+                const operators::Fraction* fraction = static_cast<const operators::Fraction*>(expr);
+                if (exact_value(fraction->get_divisor(), value) && !value.is_zero()){
+                    if (!convert(fraction->get_dividend(), result)){
+                        return false;
+                    }
+                    result = result.scaled(Rational(1) / value);
+                    return result.valid();
+                }
+                break;
+            }
+            case ExprKind::Power:{
+                const ElementaryFunctions::Power* power = static_cast<const ElementaryFunctions::Power*>(expr);
+                unsigned exponent;
+                if (integer_exponent(power, exponent)){
+                    Polynomial base;
+                    if (!convert(power->get_base(), base)){
+                        return false;
+                    }
+                    // Multinomial expansion grows fast; give up early when it cannot fit
+                    if (base.size() > 1 && exponent > 1 && (base.size() - 1) * exponent + 1 > max_terms_){
+                        return false;
+                    }
+                    result = base.pow(exponent);
+                    return fits(result);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        const Expression* simplified = expr->simplify();
+        if (simplified != expr){
+            return convert(simplified, result);
+        }
+        result = Polynomial::atom(shared_, index_.at(expr));
+        return true;
+    }
+};
+
+bool Polynomial::from_expression(const Expression* expr, Polynomial& result, size_t max_terms){
+    PolynomialBuilder builder(expr, max_terms);
+    if (!builder.build(result)){
+        expr->mark_not_polynomial();
+        return false;
+    }
+    return true;
+}
+
+Polynomial::Polynomial(std::shared_ptr<const Atoms> atoms) : atoms_(std::move(atoms)){
+    words_ = (atoms_->size() + 3) / 4;
+}
+
+Polynomial Polynomial::constant(std::shared_ptr<const Atoms> atoms, const Rational& value){
+    Polynomial result(std::move(atoms));
+    if (!value.is_zero()){
+        std::vector<uint64_t> zero(result.words_, 0);
+        result.push_term(zero.data(), value);
+    }
+    return result;
+}
+
+Polynomial Polynomial::atom(std::shared_ptr<const Atoms> atoms, size_t index){
+    Polynomial result(std::move(atoms));
+    std::vector<uint64_t> exponents(result.words_, 0);
+    exponents[index / 4] = uint64_t(1) << (16 * (3 - index % 4));
+    result.push_term(exponents.data(), Rational(1));
+    return result;
+}
+
+Polynomial Polynomial::invalid() const{
+    Polynomial result(atoms_);
+    result.valid_ = false;
+    return result;
+}
+
+unsigned Polynomial::exponent(size_t term, size_t atom) const{
+    return static_cast<unsigned>((exponents(term)[atom / 4] >> (16 * (3 - atom % 4))) & 0xffff);
+}
+
+void Polynomial::push_term(const uint64_t* exponents, const Rational& coefficient){
+    // Expansions whose coefficients leave 64 bits get expensive fast; the
+    // term-by-term collection in Sum handles those exactly without expanding
+    if (!coefficient.is_small()){
+        valid_ = false;
+        return;
+    }
+    exponents_.insert(exponents_.end(), exponents, exponents + words_);
+    coefficients_.push_back(coefficient);
+}
+
+void Polynomial::normalize(){
+    const size_t n = coefficients_.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    // Descending exponent vectors: the packing makes this a word-wise compare
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b){
+        return std::lexicographical_compare(exponents(b), exponents(b) + words_, exponents(a), exponents(a) + words_);
+    });
+
+    std::vector<uint64_t> exponents;
+    std::vector<Rational> coefficients;
+    exponents.reserve(exponents_.size());
+    coefficients.reserve(n);
+    for (size_t i = 0; i < n;){
+        size_t term = order[i];
+        Rational sum = coefficients_[term];
+        size_t j = i + 1;
+        while (j < n && std::equal(exponents_.begin() + order[j] * words_, exponents_.begin() + (order[j] + 1) * words_,
+                                   exponents_.begin() + term * words_)){
+            sum += coefficients_[order[j]];
+            ++j;
+        }
+        if (!sum.is_small()){
+            valid_ = false;
+            return;
+        }
+        if (!sum.is_zero()){
+            exponents.insert(exponents.end(), exponents_.begin() + term * words_, exponents_.begin() + (term + 1) * words_);
+            coefficients.push_back(sum);
+        }
+        i = j;
+    }
+    exponents_ = std::move(exponents);
+    coefficients_ = std::move(coefficients);
+}
+
+Polynomial Polynomial::operator+(const Polynomial& other) const{
+    if (!valid_ || !other.valid_){
+        return invalid();
+    }
+    // Both sides are sorted, so this is a merge
+    Polynomial result(atoms_);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < size() || j < other.size()){
+        int order;
+        if (i == size()){
+            order = 1;
+        }
+        else if (j == other.size()){
+            order = -1;
+        }
+        else if (std::equal(exponents(i), exponents(i) + words_, other.exponents(j))){
+            order = 0;
+        }
+        else{
+            order = std::lexicographical_compare(other.exponents(j), other.exponents(j) + words_, exponents(i), exponents(i) + words_) ? -1 : 1;
+        }
+
+        if (order < 0){
+            result.push_term(exponents(i), coefficients_[i]);
+            ++i;
+        }
+        else if (order > 0){
+            result.push_term(other.exponents(j), other.coefficients_[j]);
+            ++j;
+        }
+        else{
+            Rational sum = coefficients_[i] + other.coefficients_[j];
+            if (!sum.is_zero()){
+                result.push_term(exponents(i), sum);
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+Polynomial Polynomial::operator*(const Polynomial& other) const{
+    if (!valid_ || !other.valid_){
+        return invalid();
+    }
+    Polynomial result(atoms_);
+    result.exponents_.reserve(size() * other.size() * words_);
+    result.coefficients_.reserve(size() * other.size());
+    std::vector<uint64_t> product(words_);
+    for (size_t i = 0; i < size(); ++i){
+        for (size_t j = 0; j < other.size(); ++j){
+            for (size_t w = 0; w < words_; ++w){
+                product[w] = exponents(i)[w] + other.exponents(j)[w];
+                if (product[w] & EXPONENT_OVERFLOW){
+                    return invalid();
+                }
+            }
+            result.push_term(product.data(), coefficients_[i] * other.coefficients_[j]);
+            if (!result.valid_){
+                return result;
+            }
+        }
+    }
+    result.normalize();
+    return result;
+}
+
+Polynomial Polynomial::pow(unsigned exponent) const{
+    Polynomial result = constant(atoms_, Rational(1));
+    Polynomial base = *this;
+    while (exponent > 0 && result.valid_){
+        if (exponent & 1){
+            result = result * base;
+        }
+        exponent >>= 1;
+        if (exponent > 0){
+            base = base * base;
+        }
+    }
+    return result;
+}
+
+Polynomial Polynomial::scaled(const Rational& factor) const{
+    if (!valid_){
+        return invalid();
+    }
+    Polynomial result(atoms_);
+    if (factor.is_zero()){
+        return result;
+    }
+    result.exponents_ = exponents_;
+    result.coefficients_.reserve(size());
+    for (const Rational& coefficient : coefficients_){
+        result.coefficients_.push_back(coefficient * factor);
+        if (!result.coefficients_.back().is_small()){
+            return invalid();
+        }
+    }
+    return result;
+}
+
+const Expression* Polynomial::to_expression() const{
+    std::vector<const Expression*> terms;
+    const Expression* constantTerm = nullptr;
+    for (size_t i = 0; i < size(); ++i){
+        std::vector<const Expression*> factors;
+        for (size_t a = 0; a < atoms_->size(); ++a){
+            unsigned power = exponent(i, a);
+            if (power == 1){
+                factors.push_back((*atoms_)[a]);
+            }
+            else if (power > 1){
+                factors.push_back(ExpressionFactory::make_power((*atoms_)[a], ExpressionFactory::make_constant(power)));
+            }
+        }
+
+        if (factors.empty()){
+            constantTerm = ExpressionFactory::make_constant(coefficients_[i]);
+            continue;
+        }
+        if (coefficients_[i] != Rational(1)){
+            factors.insert(factors.begin(), ExpressionFactory::make_constant(coefficients_[i]));
+        }
+        terms.push_back(factors.size() == 1 ? factors[0] : ExpressionFactory::make_product(std::move(factors)));
+    }
+
+    // Constant term first, as the greedy simplifier writes it
+    if (constantTerm != nullptr){
+        terms.insert(terms.begin(), constantTerm);
+    }
+    if (terms.empty()){
+        return Constant::ZERO;
+    }
+    if (terms.size() == 1){
+        return terms[0];
+    }
+    return ExpressionFactory::make_sum(std::move(terms));
+}
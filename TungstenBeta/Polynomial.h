@@ -0,0 +1,64 @@
+#ifndef POLYNOMIAL_H
+#define POLYNOMIAL_H
+
+#include "Expression.h"
+#include "Rational.h"
+
+#include <memory>
+
+// Sparse multivariate polynomial with exact rational coefficients. The
+// "variables" are atoms: any subtree that is not itself a sum, product,
+// rational constant or non-negative integer power (so x, sin(x) and e all
+// work). Terms are kept sorted by exponent vector; exponents are packed four
+// 16-bit fields to a word, so comparing and multiplying monomials is a few
+// integer operations. Polynomials can only be combined when they share the
+// same atom list, which from_expression sets up for a whole subtree.
+// Coefficients stay on Rational's 64-bit fast path: an operation that would
+// need a big integer, or an exponent past 16 bits, gives an invalid result
+// instead, and operations on invalid polynomials stay invalid.
+class Polynomial{
+public:
+    Polynomial() = default;
+
+    // Expands expr into canonical form; false if a coefficient leaves 64 bits,
+    // the result would grow past max_terms or the subtree holds a node marked
+    // not_polynomial(). Nodes that fail are marked, so they are not expanded
+    // again.
+    static bool from_expression(const Expression* expr, Polynomial& result, size_t max_terms = 256);
+    // Terms by descending exponents, numeric coefficient first in each term
+    const Expression* to_expression() const;
+
+    bool valid() const { return valid_; }
+    size_t size() const { return coefficients_.size(); }
+    const std::vector<const Expression*>& atoms() const { return *atoms_; }
+
+    Polynomial operator+(const Polynomial& other) const;
+    Polynomial operator*(const Polynomial& other) const;
+    Polynomial pow(unsigned exponent) const;
+    Polynomial scaled(const Rational& factor) const;
+
+private:
+    typedef std::vector<const Expression*> Atoms;
+
+    std::shared_ptr<const Atoms> atoms_;
+    size_t words_ = 0;
+    // Term i has exponents exponents_[i * words_ .. (i + 1) * words_)
+    std::vector<uint64_t> exponents_;
+    std::vector<Rational> coefficients_;
+    bool valid_ = true;
+
+    Polynomial(std::shared_ptr<const Atoms> atoms);
+    Polynomial invalid() const;
+    static Polynomial constant(std::shared_ptr<const Atoms> atoms, const Rational& value);
+    static Polynomial atom(std::shared_ptr<const Atoms> atoms, size_t index);
+
+    const uint64_t* exponents(size_t term) const { return exponents_.data() + term * words_; }
+    unsigned exponent(size_t term, size_t atom) const;
+    void push_term(const uint64_t* exponents, const Rational& coefficient);
+    // Sorts the terms and merges equal monomials
+    void normalize();
+
+    friend class PolynomialBuilder;
+};
+
+#endif // POLYNOMIAL_H
@@ -0,0 +1,264 @@
+#include "Rational.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace{
+    __int128 gcd128(__int128 a, __int128 b){
+        if (a < 0){
+            a = -a;
+        }
+        if (b < 0){
+            b = -b;
+        }
+        while (b != 0){
+            __int128 t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    // Euclid: std::gcd is binary and slow when one side is tiny, which is
+    // the usual case here
+    unsigned long long gcd64(unsigned long long a, unsigned long long b){
+        while (b != 0){
+            unsigned long long t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    bool fits(__int128 value){
+        return value >= std::numeric_limits<long long>::min() && value <= std::numeric_limits<long long>::max();
+    }
+
+    BigInt to_big(__int128 value){
+        bool negative = value < 0;
+        unsigned __int128 magnitude = negative ? 0 - static_cast<unsigned __int128>(value) : static_cast<unsigned __int128>(value);
+        BigInt result;
+        for (int shift = 96; shift >= 0; shift -= 32){
+            result = result * BigInt(4294967296LL) + BigInt(static_cast<long long>((magnitude >> shift) & 0xffffffffU));
+        }
+        return negative ? -result : result;
+    }
+}
+
+Rational::Rational(long long numerator, long long denominator){
+    *this = reduce(static_cast<__int128>(numerator), static_cast<__int128>(denominator));
+}
+
+Rational::Rational(const BigInt& numerator, const BigInt& denominator){
+    *this = reduce(numerator, denominator);
+}
+
+Rational Rational::reduce(__int128 numerator, __int128 denominator){
+    if (denominator == 0){
+        throw std::domain_error("Rational: zero denominator");
+    }
+    if (denominator < 0){
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+    if (fits(numerator) && fits(denominator)){
+        // The common case: 64-bit division is much cheaper than 128-bit
+        long long small_numerator = static_cast<long long>(numerator);
+        long long small_denominator = static_cast<long long>(denominator);
+        unsigned long long gcd = small_denominator == 1 ? 1 : gcd64(small_numerator < 0 ? 0 - static_cast<unsigned long long>(small_numerator) : small_numerator,
+                                                                    static_cast<unsigned long long>(small_denominator));
+        Rational result;
+        result.numerator_ = gcd > 1 ? small_numerator / static_cast<long long>(gcd) : small_numerator;
+        result.denominator_ = gcd > 1 ? small_denominator / static_cast<long long>(gcd) : small_denominator;
+        if (gcd <= static_cast<unsigned long long>(std::numeric_limits<long long>::max())){
+            return result;
+        }
+    }
+    __int128 gcd = gcd128(numerator, denominator);
+    if (gcd > 1){
+        numerator /= gcd;
+        denominator /= gcd;
+    }
+    if (!fits(numerator) || !fits(denominator)){
+        return reduce(to_big(numerator), to_big(denominator));
+    }
+    Rational result;
+    result.numerator_ = static_cast<long long>(numerator);
+    result.denominator_ = static_cast<long long>(denominator);
+    return result;
+}
+
+Rational Rational::reduce(BigInt numerator, BigInt denominator){
+    if (denominator.is_zero()){
+        throw std::domain_error("Rational: zero denominator");
+    }
+    if (denominator.is_negative()){
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+    BigInt gcd = BigInt::gcd(numerator, denominator);
+    if (gcd != BigInt(1)){
+        numerator = numerator / gcd;
+        denominator = denominator / gcd;
+    }
+    return reduced(std::move(numerator), std::move(denominator));
+}
+
+Rational Rational::reduced(BigInt numerator, BigInt denominator){
+    if (numerator.is_zero()){
+        return Rational();
+    }
+    Rational result;
+    if (numerator.fits_int64() && denominator.fits_int64()){
+        result.numerator_ = numerator.to_int64();
+        result.denominator_ = denominator.to_int64();
+        return result;
+    }
+    result.numerator_ = 0;
+    result.denominator_ = 1;
+    result.big_ = std::make_shared<const Big>(Big{std::move(numerator), std::move(denominator)});
+    return result;
+}
+
+BigInt Rational::big_numerator() const{
+    return big_ ? big_->numerator : BigInt(numerator_);
+}
+
+BigInt Rational::big_denominator() const{
+    return big_ ? big_->denominator : BigInt(denominator_);
+}
+
+bool Rational::is_integer() const{
+    return big_ ? big_->denominator == BigInt(1) : denominator_ == 1;
+}
+
+bool Rational::is_negative() const{
+    return big_ ? big_->numerator.is_negative() : numerator_ < 0;
+}
+
+double Rational::to_double() const{
+    if (!big_){
+        return static_cast<double>(numerator_) / static_cast<double>(denominator_);
+    }
+    int numerator_exponent;
+    int denominator_exponent;
+    double numerator = big_->numerator.to_double(numerator_exponent);
+    double denominator = big_->denominator.to_double(denominator_exponent);
+    return std::ldexp(numerator / denominator, numerator_exponent - denominator_exponent);
+}
+
+std::string Rational::to_string() const{
+    if (big_){
+        if (big_->denominator == BigInt(1)){
+            return big_->numerator.to_string();
+        }
+        return big_->numerator.to_string() + "/" + big_->denominator.to_string();
+    }
+    if (denominator_ == 1){
+        return std::to_string(numerator_);
+    }
+    return std::to_string(numerator_) + "/" + std::to_string(denominator_);
+}
+
+size_t Rational::hash() const{
+    if (big_){
+        return std::hash<std::string>()(to_string());
+    }
+    if (denominator_ == 1){
+        return static_cast<size_t>(numerator_);
+    }
+    return static_cast<size_t>(numerator_) * 0x9e3779b97f4a7c15ULL ^ static_cast<size_t>(denominator_);
+}
+
+Rational Rational::operator-() const{
+    if (big_){
+        return reduce(-big_->numerator, big_->denominator);
+    }
+    return reduce(-static_cast<__int128>(numerator_), denominator_);
+}
+
+Rational Rational::operator+(const Rational& other) const{
+    if (!big_ && !other.big_){
+        long long sum;
+        if (denominator_ == 1 && other.denominator_ == 1 && !__builtin_add_overflow(numerator_, other.numerator_, &sum)){
+            return Rational(sum);
+        }
+        __int128 numerator;
+        if (!__builtin_add_overflow(static_cast<__int128>(numerator_) * other.denominator_,
+                                    static_cast<__int128>(other.numerator_) * denominator_, &numerator)){
+            return reduce(numerator, static_cast<__int128>(denominator_) * other.denominator_);
+        }
+    }
+    // Knuth's addition: gcds of the denominators only, which stay much
+    // smaller than those of the full cross products
+    BigInt b = big_denominator();
+    BigInt d = other.big_denominator();
+    BigInt g = BigInt::gcd(b, d);
+    if (g == BigInt(1)){
+        return reduced(big_numerator() * d + other.big_numerator() * b, b * d);
+    }
+    BigInt t = big_numerator() * (d / g) + other.big_numerator() * (b / g);
+    BigInt h = BigInt::gcd(t, g);
+    if (h == BigInt(1)){
+        return reduced(std::move(t), (b / g) * d);
+    }
+    return reduced(t / h, (b / g) * (d / h));
+}
+
+Rational Rational::operator-(const Rational& other) const{
+    return *this + (-other);
+}
+
+Rational Rational::operator*(const Rational& other) const{
+    if (!big_ && !other.big_){
+        long long product;
+        if (denominator_ == 1 && other.denominator_ == 1 && !__builtin_mul_overflow(numerator_, other.numerator_, &product)){
+            return Rational(product);
+        }
+        return reduce(static_cast<__int128>(numerator_) * other.numerator_, static_cast<__int128>(denominator_) * other.denominator_);
+    }
+    // Cancel crosswise first, so the product is already in lowest terms
+    BigInt a = big_numerator();
+    BigInt b = big_denominator();
+    BigInt c = other.big_numerator();
+    BigInt d = other.big_denominator();
+    BigInt g1 = BigInt::gcd(a, d);
+    BigInt g2 = BigInt::gcd(c, b);
+    if (g1 != BigInt(1)){
+        a = a / g1;
+        d = d / g1;
+    }
+    if (g2 != BigInt(1)){
+        c = c / g2;
+        b = b / g2;
+    }
+    return reduced(a * c, b * d);
+}
+
+Rational Rational::operator/(const Rational& other) const{
+    if (!big_ && !other.big_){
+        return reduce(static_cast<__int128>(numerator_) * other.denominator_, static_cast<__int128>(denominator_) * other.numerator_);
+    }
+    return reduce(big_numerator() * other.big_denominator(), big_denominator() * other.big_numerator());
+}
+
+bool Rational::operator==(const Rational& other) const{
+    // Both sides are in lowest terms and demoted whenever they fit, so a big
+    // value never equals a small one
+    if (!big_ && !other.big_){
+        return numerator_ == other.numerator_ && denominator_ == other.denominator_;
+    }
+    if (!big_ || !other.big_){
+        return false;
+    }
+    return big_->numerator == other.big_->numerator && big_->denominator == other.big_->denominator;
+}
+
+bool Rational::operator<(const Rational& other) const{
+    if (!big_ && !other.big_){
+        return static_cast<__int128>(numerator_) * other.denominator_ < static_cast<__int128>(other.numerator_) * denominator_;
+    }
+    return big_numerator() * other.big_denominator() < other.big_numerator() * big_denominator();
+}
@@ -0,0 +1,63 @@
+#ifndef RATIONAL_H
+#define RATIONAL_H
+
+#include "BigInt.h"
+
+#include <memory>
+#include <string>
+
+// Exact fraction numerator / denominator in lowest terms with a positive
+// denominator. Values that fit into 64 bits are stored inline and combined
+// with 128-bit intermediates; only results that overflow are promoted to a
+// shared BigInt pair, and they are demoted again as soon as they fit.
+class Rational{
+public:
+    Rational(long long value = 0) : numerator_(value), denominator_(1) {}
+    Rational(long long numerator, long long denominator);
+    Rational(const BigInt& numerator, const BigInt& denominator);
+
+    // Small values only: numerator() and denominator() are meaningless when
+    // is_small() is false
+    bool is_small() const { return !big_; }
+    long long numerator() const { return numerator_; }
+    long long denominator() const { return denominator_; }
+    bool is_small_integer() const { return !big_ && denominator_ == 1; }
+
+    BigInt big_numerator() const;
+    BigInt big_denominator() const;
+    bool is_zero() const { return !big_ && numerator_ == 0; }
+    bool is_integer() const;
+    bool is_negative() const;
+    double to_double() const;
+    std::string to_string() const;
+    size_t hash() const;
+
+    Rational operator-() const;
+    Rational operator+(const Rational& other) const;
+    Rational operator-(const Rational& other) const;
+    Rational operator*(const Rational& other) const;
+    Rational operator/(const Rational& other) const;
+    Rational& operator+=(const Rational& other) { return *this = *this + other; }
+    Rational& operator*=(const Rational& other) { return *this = *this * other; }
+
+    bool operator==(const Rational& other) const;
+    bool operator!=(const Rational& other) const { return !(*this == other); }
+    bool operator<(const Rational& other) const;
+
+private:
+    struct Big{
+        BigInt numerator;
+        BigInt denominator;
+    };
+
+    long long numerator_;
+    long long denominator_;
+    std::shared_ptr<const Big> big_;
+
+    static Rational reduce(__int128 numerator, __int128 denominator);
+    static Rational reduce(BigInt numerator, BigInt denominator);
+    // Already in lowest terms with a positive denominator: only demotes
+    static Rational reduced(BigInt numerator, BigInt denominator);
+};
+
+#endif // RATIONAL_H
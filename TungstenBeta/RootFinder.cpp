@@ -0,0 +1,218 @@
+#include "RootFinder.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <cfloat>
+#include <mutex>
+
+namespace{
+    bool same_sign(double a, double b){
+        return (a > 0 && b > 0) || (a < 0 && b < 0);
+    }
+
+    class RootSearch{
+    public:
+        RootSearch(const Expression* func, const Expression* derivative, int slot, double tolerance, size_t max_boxes)
+            : func_(func), derivative_(derivative), slot_(slot), tolerance_(tolerance), max_boxes_(max_boxes) {}
+
+        double value_at(EvalContext& context, double x) const{
+            context.set(slot_, x);
+            return func_->calculate(context);
+        }
+
+        // Subdivides root until every piece is rejected, bracketed or tiny
+        void scan(EvalContext& context, Interval root, std::vector<double>& roots){
+            std::vector<Interval> stack = {root};
+            while (!stack.empty()){
+                Interval box = stack.back();
+                stack.pop_back();
+                Interval range = func_->calculate_interval(context, slot_, box);
+                if (range.is_empty() || !range.contains(0)){
+                    continue;
+                }
+
+                double fa = value_at(context, box.lo);
+                double fb = value_at(context, box.hi);
+                if (fa == 0){
+                    roots.push_back(box.lo);
+                }
+                if (fb == 0){
+                    roots.push_back(box.hi);
+                }
+                bool bracket = std::isfinite(fa) && std::isfinite(fb) && !same_sign(fa, fb) && fa != 0 && fb != 0;
+
+                // Monotone: at most one root, and only if the sign changes
+                Interval slope = derivative_->calculate_interval(context, slot_, box);
+                bool monotone = std::isfinite(range.lo) && std::isfinite(range.hi) && std::isfinite(slope.lo) && std::isfinite(slope.hi)
+                    && !slope.contains(0);
+                bool tiny = box.width() <= 1e-9 * std::max(1.0, std::fabs(box.lo) + std::fabs(box.hi));
+                bool exhausted = boxes_.fetch_add(1, std::memory_order_relaxed) >= max_boxes_;
+
+                if (monotone || tiny || exhausted){
+                    if (bracket){
+                        accept(context, box, brent(context, box.lo, box.hi, fa, fb), roots);
+                    }
+                    else if (tiny && !monotone){
+                        // Possibly a root of even multiplicity: no sign change
+                        touching(context, box, roots);
+                    }
+                    continue;
+                }
+                double mid = box.midpoint();
+                stack.push_back(Interval{mid, box.hi});
+                stack.push_back(Interval{box.lo, mid});
+            }
+        }
+
+    private:
+        const Expression* func_;
+        const Expression* derivative_;
+        int slot_;
+        double tolerance_;
+        size_t max_boxes_;
+        std::atomic<size_t> boxes_{0};
+
+        // Brent's method on a sign-change bracket [a, b]
+        double brent(EvalContext& context, double a, double b, double fa, double fb) const{
+            double c = b;
+            double fc = fb;
+            double d = b - a;
+            double e = d;
+            for (int i = 0; i < 200; ++i){
+                if (same_sign(fb, fc)){
+                    c = a;
+                    fc = fa;
+                    d = b - a;
+                    e = d;
+                }
+                if (std::fabs(fc) < std::fabs(fb)){
+                    a = b;
+                    b = c;
+                    c = a;
+                    fa = fb;
+                    fb = fc;
+                    fc = fa;
+                }
+                double tol = 2 * DBL_EPSILON * std::fabs(b) + 0.5 * tolerance_;
+                double half = 0.5 * (c - b);
+                if (std::fabs(half) <= tol || fb == 0){
+                    return b;
+                }
+                if (std::fabs(e) >= tol && std::fabs(fa) > std::fabs(fb)){
+                    // Secant or inverse quadratic interpolation
+                    double s = fb / fa;
+                    double p;
+                    double q;
+                    if (a == c){
+                        p = 2 * half * s;
+                        q = 1 - s;
+                    }
+                    else{
+                        double r = fb / fc;
+                        q = fa / fc;
+                        p = s * (2 * half * q * (q - r) - (b - a) * (r - 1));
+                        q = (q - 1) * (r - 1) * (s - 1);
+                    }
+                    if (p > 0){
+                        q = -q;
+                    }
+                    p = std::fabs(p);
+                    if (2 * p < std::min(3 * half * q - std::fabs(tol * q), std::fabs(e * q))){
+                        e = d;
+                        d = p / q;
+                    }
+                    else{
+                        d = half;
+                        e = d;
+                    }
+                }
+                else{
+                    d = half;
+                    e = d;
+                }
+                a = b;
+                fa = fb;
+                b += std::fabs(d) > tol ? d : std::copysign(tol, half);
+                fb = value_at(context, b);
+            }
+            return b;
+        }
+
+        // Newton steps from dual numbers inside box; only improvements count
+        double newton(EvalContext& context, Interval box, double x, int steps) const{
+            context.set(slot_, x);
+            Dual f = func_->calculate_dual(context, slot_);
+            for (int i = 0; i < steps && f.value != 0 && f.derivative != 0; ++i){
+                double next = x - f.value / f.derivative;
+                if (!(box.lo <= next && next <= box.hi)){
+                    break;
+                }
+                context.set(slot_, next);
+                Dual g = func_->calculate_dual(context, slot_);
+                if (!(std::fabs(g.value) < std::fabs(f.value))){
+                    break;
+                }
+                x = next;
+                f = g;
+            }
+            return x;
+        }
+
+        // Keeps x if the function really vanishes near it; a sign change
+        // across a pole (1/x at 0) has an unbounded enclosure there
+        void accept(EvalContext& context, Interval box, double x, std::vector<double>& roots) const{
+            x = newton(context, box, x, 3);
+            double radius = 4 * DBL_EPSILON * std::max(1.0, std::fabs(x)) + tolerance_;
+            Interval near{std::max(box.lo, x - radius), std::min(box.hi, x + radius)};
+            Interval range = func_->calculate_interval(context, slot_, near);
+            if (std::isfinite(range.lo) && std::isfinite(range.hi) && range.contains(0)){
+                roots.push_back(x);
+            }
+        }
+
+        void touching(EvalContext& context, Interval box, std::vector<double>& roots) const{
+            // Multiple roots converge linearly: allow more steps
+            double x = newton(context, box, box.midpoint(), 60);
+            double fx = value_at(context, x);
+            double scale = std::max(1.0, std::fabs(value_at(context, box.lo)) + std::fabs(value_at(context, box.hi)));
+            if (std::fabs(fx) <= 1e-12 * scale){
+                accept(context, box, x, roots);
+            }
+        }
+    };
+}
+
+std::vector<double> RootFinder::find_roots(const Expression* func, const std::string& variable, double lo, double hi,
+                                           double tolerance, size_t max_boxes){
+    std::vector<double> roots;
+    if (!(lo <= hi) || !std::isfinite(lo) || !std::isfinite(hi)){
+        return roots;
+    }
+
+    // Built in the caller's arena; the threads only evaluate
+    const Expression* derivative = func->complex_derivative(variable);
+    RootSearch search(func, derivative, EvalContext::slot_of(variable), tolerance, max_boxes);
+
+    size_t slices = lo < hi ? 8 * parallel_workers() : 1;
+    double width = hi - lo;
+    std::mutex mutex;
+    parallel_for(slices, [&](EvalContext& context, size_t i){
+        double a = lo + width * i / slices;
+        double b = i + 1 == slices ? hi : lo + width * (i + 1) / slices;
+        std::vector<double> found;
+        search.scan(context, Interval{a, b}, found);
+        std::lock_guard<std::mutex> lock(mutex);
+        roots.insert(roots.end(), found.begin(), found.end());
+    });
+
+    // Slices share their edges, and neighbouring tiny boxes can converge to
+    // the same root
+    std::sort(roots.begin(), roots.end());
+    std::vector<double> unique;
+    for (double root : roots){
+        if (unique.empty() || root - unique.back() > 16 * (tolerance + 4 * DBL_EPSILON * std::max(1.0, std::fabs(root)))){
+            unique.push_back(root);
+        }
+    }
+    return unique;
+}
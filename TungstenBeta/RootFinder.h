@@ -0,0 +1,21 @@
+#ifndef ROOT_FINDER_H
+#define ROOT_FINDER_H
+
+#include "Expression.h"
+
+// All roots of a one-variable expression in a closed interval. The interval
+// is cut into slices that are searched in parallel: a box is dropped when
+// the interval enclosure of the function excludes zero, and is split until
+// the function is provably monotone on it (one root at most) or it is tiny.
+// Sign-change brackets are then solved with Brent's method and polished
+// with Newton steps from dual numbers; tiny boxes without a sign change
+// (roots of even multiplicity such as x^2) get Newton alone.
+class RootFinder{
+public:
+    // Sorted roots; roots closer than about tolerance are reported once.
+    // If the box budget runs out, roots in the unexplored part can be missed.
+    static std::vector<double> find_roots(const Expression* func, const std::string& variable, double lo, double hi,
+                                          double tolerance = 1e-12, size_t max_boxes = 1000000);
+};
+
+#endif // ROOT_FINDER_H
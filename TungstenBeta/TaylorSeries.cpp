@@ -0,0 +1,526 @@
+#include "TaylorSeries.h"
+#include "Constant.h"
+#include "Variable.h"
+#include "operators.h"
+#include "ElementaryFunctions.h"
+
+namespace{
+    // Values of the elementary functions at the constant term. Rationals only
+    // have the few exact cases (exp 0 = 1, log 1 = 0, ...).
+    template <typename T>
+    struct Scalar;
+
+    template <>
+    struct Scalar<double>{
+        static bool constant(const Expression* expr, double& value){
+            value = expr->calculate();
+            return true;
+        }
+        static bool integer(double value, long long& n){
+            if (value != std::floor(value) || std::fabs(value) > 1e15){
+                return false;
+            }
+            n = static_cast<long long>(value);
+            return true;
+        }
+        static bool exp(double x, double& value){
+            value = std::exp(x);
+            return std::isfinite(value);
+        }
+        static bool log(double x, double& value){
+            value = std::log(x);
+            return x > 0 && std::isfinite(value);
+        }
+        static bool sin_cos(double x, double& s, double& c){
+            s = std::sin(x);
+            c = std::cos(x);
+            return std::isfinite(s);
+        }
+        static bool tan(double x, double& value){
+            value = std::tan(x);
+            return std::isfinite(value);
+        }
+        static bool cot(double x, double& value){
+            value = std::cos(x) / std::sin(x);
+            return std::isfinite(value);
+        }
+        static bool pow(double base, double power, double& value){
+            value = std::pow(base, power);
+            return std::isfinite(value);
+        }
+        static bool valid(double value){
+            return std::isfinite(value);
+        }
+    };
+
+    template <>
+    struct Scalar<Rational>{
+        static bool constant(const Expression* expr, Rational& value){
+            if (expr == Constant::e || expr == Constant::pi){
+                return false;
+            }
+            value = static_cast<const Constant*>(expr)->get_value();
+            return true;
+        }
+        static bool integer(const Rational& value, long long& n){
+            if (!value.is_small_integer()){
+                return false;
+            }
+            n = value.numerator();
+            return true;
+        }
+        static bool exp(const Rational& x, Rational& value){
+            value = 1;
+            return x.is_zero();
+        }
+        static bool log(const Rational& x, Rational& value){
+            value = 0;
+            return x == Rational(1);
+        }
+        static bool sin_cos(const Rational& x, Rational& s, Rational& c){
+            s = 0;
+            c = 1;
+            return x.is_zero();
+        }
+        static bool tan(const Rational& x, Rational& value){
+            value = 0;
+            return x.is_zero();
+        }
+        static bool cot(const Rational&, Rational&){
+            return false;
+        }
+        // Integer powers, and 1 to any power
+        static bool pow(const Rational& base, const Rational& power, Rational& value){
+            long long n;
+            if (!integer(power, n)){
+                value = 1;
+                return base == Rational(1);
+            }
+            if (base.is_zero()){
+                value = n == 0 ? 1 : 0;
+                return n >= 0;
+            }
+            Rational square = n < 0 ? Rational(1) / base : base;
+            unsigned long long bits = n < 0 ? 0 - static_cast<unsigned long long>(n) : n;
+            value = 1;
+            for (; bits != 0; bits >>= 1){
+                if (bits & 1){
+                    value *= square;
+                }
+                if (bits > 1){
+                    square *= square;
+                }
+            }
+            return true;
+        }
+        static bool valid(const Rational&){
+            return true;
+        }
+    };
+
+    template <typename T>
+    using Series = std::vector<T>;
+
+    template <typename T>
+    bool is_constant(const Series<T>& a){
+        for (size_t k = 1; k < a.size(); ++k){
+            if (!(a[k] == T(0))){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // k u[k]: the coefficients of h u'(h), shared by the recurrences below
+    template <typename T>
+    Series<T> scaled(const Series<T>& u){
+        Series<T> du(u.size());
+        for (size_t k = 0; k < u.size(); ++k){
+            du[k] = T(static_cast<long long>(k)) * u[k];
+        }
+        return du;
+    }
+
+    template <typename T>
+    Series<T> add(const Series<T>& a, const Series<T>& b){
+        Series<T> c(a.size());
+        for (size_t k = 0; k < a.size(); ++k){
+            c[k] = a[k] + b[k];
+        }
+        return c;
+    }
+
+    // Cauchy product; leading zeros are skipped since x^k factors are common
+    template <typename T>
+    Series<T> multiply(const Series<T>& a, const Series<T>& b){
+        size_t n = a.size();
+        size_t first_a = 0;
+        size_t first_b = 0;
+        while (first_a < n && a[first_a] == T(0)){
+            ++first_a;
+        }
+        while (first_b < n && b[first_b] == T(0)){
+            ++first_b;
+        }
+        Series<T> c(n, T(0));
+        for (size_t i = first_a; i < n; ++i){
+            for (size_t j = first_b; i + j < n; ++j){
+                c[i + j] += a[i] * b[j];
+            }
+        }
+        return c;
+    }
+
+    // a / b with b[0] != 0: c[k] = (a[k] - sum_{j=1..k} b[j] c[k-j]) / b[0]
+    template <typename T>
+    Series<T> divide(const Series<T>& a, const Series<T>& b){
+        Series<T> c(a.size());
+        for (size_t k = 0; k < a.size(); ++k){
+            T sum = a[k];
+            for (size_t j = 1; j <= k; ++j){
+                sum = sum - b[j] * c[k - j];
+            }
+            c[k] = sum / b[0];
+        }
+        return c;
+    }
+
+    // w = exp(u), w' = u' w: k w[k] = sum_{j=1..k} j u[j] w[k-j]
+    template <typename T>
+    Series<T> exp_series(const Series<T>& u, const T& w0){
+        Series<T> du = scaled(u);
+        Series<T> w(u.size());
+        w[0] = w0;
+        for (size_t k = 1; k < u.size(); ++k){
+            T sum = 0;
+            for (size_t j = 1; j <= k; ++j){
+                if (!(du[j] == T(0))){
+                    sum += du[j] * w[k - j];
+                }
+            }
+            w[k] = sum / T(static_cast<long long>(k));
+        }
+        return w;
+    }
+
+    // w = log(u), u w' = u': k u[0] w[k] = k u[k] - sum_{j=1..k-1} j w[j] u[k-j]
+    template <typename T>
+    Series<T> log_series(const Series<T>& u, const T& w0){
+        Series<T> w(u.size());
+        w[0] = w0;
+        for (size_t k = 1; k < u.size(); ++k){
+            T sum = T(static_cast<long long>(k)) * u[k];
+            for (size_t j = 1; j < k; ++j){
+                sum = sum - T(static_cast<long long>(j)) * w[j] * u[k - j];
+            }
+            w[k] = sum / (T(static_cast<long long>(k)) * u[0]);
+        }
+        return w;
+    }
+
+    // s' = u' c, c' = -u' s, built together
+    template <typename T>
+    void sin_cos_series(const Series<T>& u, const T& s0, const T& c0, Series<T>& s, Series<T>& c){
+        s.assign(u.size(), T(0));
+        c.assign(u.size(), T(0));
+        s[0] = s0;
+        c[0] = c0;
+        Series<T> du = scaled(u);
+        for (size_t k = 1; k < u.size(); ++k){
+            T sum_s = 0;
+            T sum_c = 0;
+            for (size_t j = 1; j <= k; ++j){
+                if (!(du[j] == T(0))){
+                    sum_s += du[j] * c[k - j];
+                    sum_c += du[j] * s[k - j];
+                }
+            }
+            s[k] = sum_s / T(static_cast<long long>(k));
+            c[k] = T(0) - sum_c / T(static_cast<long long>(k));
+        }
+    }
+
+    // t' = sign (1 + t^2) u': tan for sign 1, cot for sign -1. v = 1 + t^2
+    // is extended by one coefficient before each step.
+    template <typename T>
+    Series<T> tan_series(const Series<T>& u, const T& t0, long long sign){
+        Series<T> du = scaled(u);
+        Series<T> t(u.size(), T(0));
+        Series<T> v(u.size(), T(0));
+        t[0] = t0;
+        for (size_t k = 1; k < u.size(); ++k){
+            T square = k == 1 ? T(1) : T(0);
+            for (size_t i = 0; i < k; ++i){
+                square += t[i] * t[k - 1 - i];
+            }
+            v[k - 1] = square;
+            T sum = 0;
+            for (size_t j = 1; j <= k; ++j){
+                if (!(du[j] == T(0))){
+                    sum += du[j] * v[k - j];
+                }
+            }
+            t[k] = T(sign) * sum / T(static_cast<long long>(k));
+        }
+        return t;
+    }
+
+    // w = u^p with u[0] != 0, u w' = p u' w:
+    // k u[0] w[k] = sum_{j=1..k} ((p + 1) j - k) u[j] w[k-j]
+    template <typename T>
+    Series<T> power_series(const Series<T>& u, const T& p, const T& w0){
+        Series<T> w(u.size());
+        w[0] = w0;
+        for (size_t k = 1; k < u.size(); ++k){
+            T sum = 0;
+            for (size_t j = 1; j <= k; ++j){
+                T weight = (p + T(1)) * T(static_cast<long long>(j)) - T(static_cast<long long>(k));
+                sum += weight * u[j] * w[k - j];
+            }
+            w[k] = sum / (T(static_cast<long long>(k)) * u[0]);
+        }
+        return w;
+    }
+
+    template <typename T>
+    class SeriesEvaluator{
+    public:
+        SeriesEvaluator(const std::string& variable, const T& point, size_t size)
+            : variable_(variable), point_(point), size_(size) {}
+
+        // Series of expr, memoized so shared subtrees are expanded once
+        bool evaluate(const Expression* expr, Series<T>& result){
+            auto it = done_.find(expr);
+            if (it != done_.end()){
+                result = it->second;
+                return true;
+            }
+            if (!compute(expr, result)){
+                return false;
+            }
+            for (const T& value : result){
+                if (!Scalar<T>::valid(value)){
+                    return false;
+                }
+            }
+            done_.emplace(expr, result);
+            return true;
+        }
+
+    private:
+        std::string variable_;
+        T point_;
+        size_t size_;
+        std::unordered_map<const Expression*, Series<T>> done_;
+
+        Series<T> constant(const T& value) const{
+            Series<T> result(size_, T(0));
+            result[0] = value;
+            return result;
+        }
+
+        bool log_of(const Expression* expr, Series<T>& result){
+            Series<T> u;
+            T w0;
+            if (!evaluate(expr, u) || u[0] == T(0) || !Scalar<T>::log(u[0], w0)){
+                return false;
+            }
+            result = log_series(u, w0);
+            return true;
+        }
+
+        bool exp_of(const Series<T>& u, Series<T>& result){
+            T w0;
+            if (!Scalar<T>::exp(u[0], w0)){
+                return false;
+            }
+            result = exp_series(u, w0);
+            return true;
+        }
+
+        bool power_of(const Series<T>& u, const T& p, Series<T>& result){
+            if (!(u[0] == T(0))){
+                T w0;
+                if (!Scalar<T>::pow(u[0], p, w0)){
+                    return false;
+                }
+                result = power_series(u, p, w0);
+                return true;
+            }
+            // u = h^m v with v[0] != 0 is analytic only for integer p >= 0:
+            // u^p = h^(m p) v^p
+            long long n;
+            if (!Scalar<T>::integer(p, n) || n < 0){
+                return false;
+            }
+            size_t m = 1;
+            while (m < size_ && u[m] == T(0)){
+                ++m;
+            }
+            result = constant(T(n == 0 ? 1 : 0));
+            if (n == 0 || m == size_ || static_cast<unsigned long long>(n) >= size_){
+                return true;
+            }
+            size_t shift = m * static_cast<size_t>(n);
+            if (shift >= size_){
+                return true;
+            }
+            Series<T> v(size_ - shift);
+            for (size_t i = 0; i < v.size(); ++i){
+                v[i] = u[i + m];
+            }
+            T w0;
+            if (!Scalar<T>::pow(v[0], p, w0)){
+                return false;
+            }
+            Series<T> w = power_series(v, p, w0);
+            for (size_t i = 0; i < w.size(); ++i){
+                result[i + shift] = w[i];
+            }
+            return true;
+        }
+
+        bool compute(const Expression* expr, Series<T>& result){
+            switch (expr->kind()){
+                case ExprKind::Constant:{
+                    T value;
+                    if (!Scalar<T>::constant(expr, value)){
+                        return false;
+                    }
+                    result = constant(value);
+                    return true;
+                }
+                case ExprKind::Variable:{
+                    result = constant(T(0));
+                    if (static_cast<const Variable*>(expr)->get_name() == variable_){
+                        result[0] = point_;
+                        if (size_ > 1){
+                            result[1] = 1;
+                        }
+                    }
+                    return true;
+                }
+                case ExprKind::Sum:{
+                    result = constant(T(0));
+                    for (const Expression* term : static_cast<const operators::Sum*>(expr)->get_terms()){
+                        Series<T> a;
+                        if (!evaluate(term, a)){
+                            return false;
+                        }
+                        result = add(result, a);
+                    }
+                    return true;
+                }
+                case ExprKind::Product:{
+                    result = constant(T(1));
+                    for (const Expression* factor : static_cast<const operators::Product*>(expr)->get_factors()){
+                        Series<T> a;
+                        if (!evaluate(factor, a)){
+                            return false;
+                        }
+                        result = multiply(result, a);
+                    }
+                    return true;
+                }
+                case ExprKind::Fraction:{
+                    const operators::Fraction* fraction = static_cast<const operators::Fraction*>(expr);
+                    Series<T> a;
+                    Series<T> b;
+                    if (!evaluate(fraction->get_dividend(), a) || !evaluate(fraction->get_divisor(), b) || b[0] == T(0)){
+                        return false;
+                    }
+                    result = divide(a, b);
+                    return true;
+                }
+                case ExprKind::Power:{
+                    const ElementaryFunctions::Power* power = static_cast<const ElementaryFunctions::Power*>(expr);
+                    Series<T> u;
+                    Series<T> p;
+                    if (!evaluate(power->get_base(), u) || !evaluate(power->get_power(), p)){
+                        return false;
+                    }
+                    if (is_constant(p)){
+                        return power_of(u, p[0], result);
+                    }
+                    // Variable exponent: u^p = exp(p log u)
+                    Series<T> log_u;
+                    return log_of(power->get_base(), log_u) && exp_of(multiply(p, log_u), result);
+                }
+                case ExprKind::Exp:{
+                    const ElementaryFunctions::Exp* exp = static_cast<const ElementaryFunctions::Exp*>(expr);
+                    Series<T> p;
+                    if (!evaluate(exp->get_power(), p)){
+                        return false;
+                    }
+                    if (exp->get_base() == Constant::e){
+                        return exp_of(p, result);
+                    }
+                    Series<T> log_base;
+                    return log_of(exp->get_base(), log_base) && exp_of(multiply(p, log_base), result);
+                }
+                case ExprKind::Log:{
+                    const ElementaryFunctions::Log* log = static_cast<const ElementaryFunctions::Log*>(expr);
+                    if (!log_of(log->get_arg(), result)){
+                        return false;
+                    }
+                    if (log->get_base() == Constant::e){
+                        return true;
+                    }
+                    Series<T> log_base;
+                    if (!log_of(log->get_base(), log_base) || log_base[0] == T(0)){
+                        return false;
+                    }
+                    result = divide(result, log_base);
+                    return true;
+                }
+                case ExprKind::Sin:
+                case ExprKind::Cos:{
+                    const Expression* arg = expr->kind() == ExprKind::Sin ? static_cast<const ElementaryFunctions::Sin*>(expr)->get_arg()
+                                                                          : static_cast<const ElementaryFunctions::Cos*>(expr)->get_arg();
+                    Series<T> u;
+                    T s0;
+                    T c0;
+                    if (!evaluate(arg, u) || !Scalar<T>::sin_cos(u[0], s0, c0)){
+                        return false;
+                    }
+                    Series<T> s;
+                    Series<T> c;
+                    sin_cos_series(u, s0, c0, s, c);
+                    result = expr->kind() == ExprKind::Sin ? s : c;
+                    return true;
+                }
+                case ExprKind::Tan:{
+                    Series<T> u;
+                    T t0;
+                    if (!evaluate(static_cast<const ElementaryFunctions::Tan*>(expr)->get_arg(), u) || !Scalar<T>::tan(u[0], t0)){
+                        return false;
+                    }
+                    result = tan_series(u, t0, 1);
+                    return true;
+                }
+                case ExprKind::Cot:{
+                    Series<T> u;
+                    T t0;
+                    if (!evaluate(static_cast<const ElementaryFunctions::Cot*>(expr)->get_arg(), u) || !Scalar<T>::cot(u[0], t0)){
+                        return false;
+                    }
+                    result = tan_series(u, t0, -1);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+bool TaylorSeries::coefficients(const Expression* f, const std::string& variable, double point, size_t order,
+                                std::vector<double>& coefficients){
+    SeriesEvaluator<double> evaluator(variable, point, order + 1);
+    return evaluator.evaluate(f, coefficients);
+}
+
+bool TaylorSeries::exact_coefficients(const Expression* f, const std::string& variable, const Rational& point, size_t order,
+                                      std::vector<Rational>& coefficients){
+    SeriesEvaluator<Rational> evaluator(variable, point, order + 1);
+    return evaluator.evaluate(f, coefficients);
+}
@@ -0,0 +1,24 @@
+#ifndef TAYLOR_SERIES_H
+#define TAYLOR_SERIES_H
+
+#include "Expression.h"
+#include "Rational.h"
+
+// Taylor coefficients by evaluating the expression on truncated power series
+// (Taylor-mode automatic differentiation). Every node turns the series of
+// its children into its own with the usual recurrences (exp, log, sin/cos,
+// tan, powers), so order n costs O(n^2) arithmetic per node instead of n
+// symbolic derivatives. Other variables of f are treated as 0.
+class TaylorSeries{
+public:
+    // coefficients[k] is the coefficient of (variable - point)^k for k up to
+    // order. False if f is not analytic at point (a pole, sqrt at 0, ...).
+    static bool coefficients(const Expression* f, const std::string& variable, double point, size_t order,
+                             std::vector<double>& coefficients);
+    // Same with exact arithmetic. Also false when a coefficient is irrational,
+    // e.g. when f uses pi or sin is expanded around a nonzero value.
+    static bool exact_coefficients(const Expression* f, const std::string& variable, const Rational& point, size_t order,
+                                   std::vector<Rational>& coefficients);
+};
+
+#endif // TAYLOR_SERIES_H
@@ -4,20 +4,21 @@
 #include "operators.h"
 #include "Constant.h"
 #include "ElementaryFunctions.h"
+#include "ExpressionFactory.h"
 
 // overloading
 const Expression* operator+(const Expression& lhs, const Expression& rhs){
-    return (new operators::Sum({lhs.copy(), rhs.copy()}))->simplify();
+    return ExpressionFactory::make_sum({lhs.copy(), rhs.copy()})->simplify();
 }
 
 const Expression* operator-(const Expression& lhs, const Expression& rhs){
-    return (new operators::Sum({lhs.copy(), new operators::Product({new Constant(-1), rhs.copy()})}))->simplify();
+    return ExpressionFactory::make_sum({lhs.copy(), ExpressionFactory::make_product({ExpressionFactory::make_constant(-1), rhs.copy()})})->simplify();
 }
 
 const Expression* operator*(const Expression& lhs, const Expression& rhs){
-    return (new operators::Product({lhs.copy(), rhs.copy()}))->simplify();
+    return ExpressionFactory::make_product({lhs.copy(), rhs.copy()})->simplify();
 }
 
 const Expression* operator/(const Expression& lhs, const Expression& rhs){
-    return (new operators::Fraction(lhs.copy(), rhs.copy()))->simplify();
+    return ExpressionFactory::make_fraction(lhs.copy(), rhs.copy())->simplify();
 }
\ No newline at end of file
@@ -7,5 +7,23 @@
 #include "operators.h"
 #include "ElementaryFunctions.h"
 #include "Methods.h"
+#include "ExpressionFactory.h"
+#include "ExpressionArena.h"
+#include "ExpressionVisitor.h"
+#include "CompiledExpression.h"
+#include "NativeExpression.h"
+#include "EvalContext.h"
+#include "Dual.h"
+#include "Interval.h"
+#include "EGraph.h"
+#include "BigInt.h"
+#include "Rational.h"
+#include "Polynomial.h"
+#include "Optimizer.h"
+#include "RootFinder.h"
+#include "TaylorSeries.h"
+#include "Parser.h"
+#include "MappedExpression.h"
+#include "ExpressionCache.h"
 
 #endif // TUNGSTENBETA_H
\ No newline at end of file
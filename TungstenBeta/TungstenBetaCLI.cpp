@@ -0,0 +1,376 @@
+// TungstenBetaCLI.cpp
+#include "TungstenBetaCLI.h"
+#include "TungstenBeta.h"
+#include "Parallel.h"
+#include "ExpressionCache.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace{
+    enum class Mode{ Eval, Derivative, Roots, Taylor };
+
+    struct Options{
+        Mode mode = Mode::Eval;
+        std::string variable = "x";
+        double at = 0;
+        double from = -10;
+        double to = 10;
+        size_t order = 4;
+        size_t threads = parallel_workers();
+        // Values of other variables, by slot
+        std::vector<std::pair<int, double>> values;
+        const char* file = nullptr;
+        // Directory of an ExpressionCache for derivatives, if any
+        const char* cache = nullptr;
+    };
+
+    // Lines per batch: enough to keep every worker busy, few enough that
+    // the results of one batch stay small
+    const size_t BATCH_LINES = 4096;
+
+    // State a worker keeps between batches. The arena is reset after every
+    // batch, once its results have been formatted.
+    struct Worker{
+        ExpressionArena arena;
+        EvalContext context;
+    };
+
+    void usage(){
+        std::fputs("usage: tungsten-cli [options] [file]\n"
+                   "Reads one expression per line from file or stdin and writes one result per line.\n"
+                   "  -m, --mode MODE        eval (default), derivative, roots or taylor\n"
+                   "  -v, --variable NAME    variable of derivative, roots and taylor (default x)\n"
+                   "  -a, --at VALUE         value of the variable for eval and taylor (default 0)\n"
+                   "  -s, --set NAME=VALUE   value of another variable for eval (default 0)\n"
+                   "      --from LO          start of the interval searched by roots (default -10)\n"
+                   "      --to HI            end of the interval searched by roots (default 10)\n"
+                   "  -n, --order N          order of taylor (default 4)\n"
+                   "  -c, --cache DIR        keep derivatives in DIR across runs\n"
+                   "  -j, --threads N        worker threads (default: one per core)\n", stderr);
+    }
+
+    bool read_double(const char* text, double& value){
+        char* end = nullptr;
+        value = std::strtod(text, &end);
+        return *text != '\0' && *end == '\0' && std::isfinite(value);
+    }
+
+    bool read_size(const char* text, size_t& value){
+        char* end = nullptr;
+        unsigned long long parsed = std::strtoull(text, &end, 10);
+        value = static_cast<size_t>(parsed);
+        return *text != '\0' && *end == '\0' && text[0] != '-';
+    }
+
+    bool parse_options(int argc, char *argv[], Options& options){
+        for (int i = 1; i < argc; ++i){
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help"){
+                return false;
+            }
+            if (arg[0] != '-' || arg == "-"){
+                if (options.file != nullptr){
+                    return false;
+                }
+                options.file = arg == "-" ? nullptr : argv[i];
+                continue;
+            }
+            if (i + 1 == argc){
+                std::fprintf(stderr, "tungsten-cli: %s needs a value\n", arg.c_str());
+                return false;
+            }
+            const char* value = argv[++i];
+            bool valid = true;
+            if (arg == "-m" || arg == "--mode"){
+                std::string mode = value;
+                if (mode == "eval"){
+                    options.mode = Mode::Eval;
+                }
+                else if (mode == "derivative"){
+                    options.mode = Mode::Derivative;
+                }
+                else if (mode == "roots"){
+                    options.mode = Mode::Roots;
+                }
+                else if (mode == "taylor"){
+                    options.mode = Mode::Taylor;
+                }
+                else{
+                    valid = false;
+                }
+            }
+            else if (arg == "-v" || arg == "--variable"){
+                options.variable = value;
+                valid = !options.variable.empty();
+            }
+            else if (arg == "-a" || arg == "--at"){
+                valid = read_double(value, options.at);
+            }
+            else if (arg == "-s" || arg == "--set"){
+                const char* equals = std::strchr(value, '=');
+                double number;
+                valid = equals != nullptr && equals != value && read_double(equals + 1, number);
+                if (valid){
+                    options.values.emplace_back(EvalContext::slot_of(std::string(value, equals)), number);
+                }
+            }
+            else if (arg == "--from"){
+                valid = read_double(value, options.from);
+            }
+            else if (arg == "--to"){
+                valid = read_double(value, options.to);
+            }
+            else if (arg == "-n" || arg == "--order"){
+                valid = read_size(value, options.order) && options.order <= 100000;
+            }
+            else if (arg == "-c" || arg == "--cache"){
+                options.cache = value;
+                valid = *value != '\0';
+            }
+            else if (arg == "-j" || arg == "--threads"){
+                valid = read_size(value, options.threads) && options.threads >= 1;
+            }
+            else{
+                std::fprintf(stderr, "tungsten-cli: unknown option %s\n", arg.c_str());
+                return false;
+            }
+            if (!valid){
+                std::fprintf(stderr, "tungsten-cli: invalid value '%s' for %s\n", value, arg.c_str());
+                return false;
+            }
+        }
+        if (options.from > options.to){
+            std::fprintf(stderr, "tungsten-cli: --from is greater than --to\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Shortest text that reads back as the same double
+    void append_number(std::string& output, double value){
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        output.append(buffer, result.ptr);
+    }
+
+    // Result of one line; errors are reported in place, prefixed by "error: "
+    std::string process_line(std::string_view line, const Options& options, EvalContext& context, ExpressionCache* cache,
+                             bool& failed){
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')){
+            line.remove_suffix(1);
+        }
+        std::string output;
+        if (line.find_first_not_of(" \t") == std::string_view::npos){
+            return output;
+        }
+        try{
+            if (options.mode == Mode::Derivative && cache != nullptr){
+                return cache->derivative(line, options.variable)->to_string();
+            }
+            const Expression* expr = Parser::parse(line);
+            switch (options.mode){
+                case Mode::Eval:
+                    append_number(output, expr->calculate(context));
+                    break;
+                case Mode::Derivative:
+                    output = expr->complex_derivative(options.variable)->simplify()->to_string();
+                    break;
+                case Mode::Roots:
+                    for (double root : RootFinder::find_roots(expr, options.variable, options.from, options.to)){
+                        if (!output.empty()){
+                            output += ' ';
+                        }
+                        append_number(output, root);
+                    }
+                    break;
+                case Mode::Taylor:{
+                    const Expression* taylor = Taylor_series(expr, options.variable, options.at, options.order);
+                    if (taylor == nullptr){
+                        failed = true;
+                        output = "error: not analytic at ";
+                        append_number(output, options.at);
+                        return output;
+                    }
+                    output = taylor->to_string();
+                    break;
+                }
+            }
+        } catch (const std::exception& error){
+            failed = true;
+            return std::string("error: ") + error.what();
+        }
+        return output;
+    }
+
+    // Processes lines in parallel and writes their results in input order
+    class BatchProcessor{
+    public:
+        explicit BatchProcessor(const Options& options) : options_(options), pool_(options.threads) {
+            if (options.cache != nullptr){
+                cache_ = std::make_unique<ExpressionCache>(options.cache);
+            }
+            int slot = EvalContext::slot_of(options.variable);
+            for (size_t i = 0; i < pool_.size(); ++i){
+                workers_.push_back(std::make_unique<Worker>());
+                workers_.back()->context.set(slot, options.at);
+                for (const auto& value : options.values){
+                    workers_.back()->context.set(value.first, value.second);
+                }
+            }
+        }
+
+        // Lines must stay valid until the next flush()
+        void add(std::string_view line){
+            lines_.push_back(line);
+            if (lines_.size() == BATCH_LINES){
+                flush();
+            }
+        }
+
+        void flush(){
+            if (lines_.empty()){
+                return;
+            }
+            results_.resize(lines_.size());
+            pool_.for_each(lines_.size(), [this](size_t worker, size_t i){
+                Worker& state = *workers_[worker];
+                ExpressionArena::Scope scope(state.arena);
+                bool failed = false;
+                results_[i] = process_line(lines_[i], options_, state.context, cache_.get(), failed);
+                if (failed){
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            });
+            for (std::string& result : results_){
+                result += '\n';
+                std::fwrite(result.data(), 1, result.size(), stdout);
+            }
+            for (auto& worker : workers_){
+                worker->arena.reset();
+            }
+            lines_.clear();
+            results_.clear();
+        }
+
+        bool failed() const { return failed_.load(); }
+
+    private:
+        const Options& options_;
+        ThreadPool pool_;
+        std::unique_ptr<ExpressionCache> cache_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::string_view> lines_;
+        std::vector<std::string> results_;
+        std::atomic<bool> failed_{false};
+    };
+
+    // Splits text into lines; the last one may lack its newline
+    void add_lines(std::string_view text, BatchProcessor& processor){
+        while (!text.empty()){
+            size_t end = text.find('\n');
+            if (end == std::string_view::npos){
+                processor.add(text);
+                return;
+            }
+            processor.add(text.substr(0, end));
+            text.remove_prefix(end + 1);
+        }
+    }
+
+    bool process_file(const char* path, BatchProcessor& processor){
+        int fd = open(path, O_RDONLY);
+        if (fd < 0){
+            std::fprintf(stderr, "tungsten-cli: cannot open %s: %s\n", path, std::strerror(errno));
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0){
+            std::fprintf(stderr, "tungsten-cli: cannot read %s: %s\n", path, std::strerror(errno));
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size == 0){
+            close(fd);
+            return true;
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED){
+            std::fprintf(stderr, "tungsten-cli: cannot map %s: %s\n", path, std::strerror(errno));
+            return false;
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+        add_lines(std::string_view(static_cast<const char*>(data), size), processor);
+        processor.flush();
+        munmap(data, size);
+        return true;
+    }
+
+    // Streams stdin: the complete lines of each read are processed at once,
+    // and the partial line at its end is kept for the next one. read(2)
+    // returns whatever a pipe holds, so a client feeding lines one at a time
+    // gets each answer back without closing its end; output is flushed
+    // after every batch unless stdin is a regular file.
+    bool process_stdin(BatchProcessor& processor){
+        const size_t CHUNK = 1 << 20;
+        struct stat info;
+        bool interactive = fstat(STDIN_FILENO, &info) != 0 || !S_ISREG(info.st_mode);
+        std::string buffer;
+        std::vector<char> chunk(CHUNK);
+        while (true){
+            ssize_t count = ::read(STDIN_FILENO, chunk.data(), CHUNK);
+            if (count < 0 && errno == EINTR){
+                continue;
+            }
+            if (count < 0){
+                std::fprintf(stderr, "tungsten-cli: cannot read stdin: %s\n", std::strerror(errno));
+                return false;
+            }
+            if (count == 0){
+                break;
+            }
+            buffer.append(chunk.data(), static_cast<size_t>(count));
+            size_t complete = buffer.rfind('\n');
+            if (complete == std::string::npos){
+                continue;
+            }
+            add_lines(std::string_view(buffer).substr(0, complete + 1), processor);
+            processor.flush();
+            if (interactive){
+                std::fflush(stdout);
+            }
+            buffer.erase(0, complete + 1);
+        }
+        add_lines(buffer, processor);
+        processor.flush();
+        return true;
+    }
+}
+
+int run_cli(int argc, char *argv[]){
+    Options options;
+    if (!parse_options(argc, argv, options)){
+        usage();
+        return 2;
+    }
+    static char output_buffer[1 << 16];
+    std::setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
+
+    BatchProcessor processor(options);
+    bool read = options.file != nullptr ? process_file(options.file, processor) : process_stdin(processor);
+    std::fflush(stdout);
+    if (!read){
+        return 2;
+    }
+    return processor.failed() ? 1 : 0;
+}
@@ -0,0 +1,9 @@
+#ifndef TUNGSTENBETA_CLI_H
+#define TUNGSTENBETA_CLI_H
+
+// Headless batch front end: one expression per input line (a file, which is
+// memory-mapped, or stdin), one result per output line in the same order.
+// Lines are processed in batches across a thread pool. Does not touch GTK.
+int run_cli(int argc, char *argv[]);
+
+#endif // TUNGSTENBETA_CLI_H
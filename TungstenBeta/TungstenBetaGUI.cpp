@@ -4,11 +4,8 @@
 #include <gtk/gtk.h>
 
 #include <sstream>
-#include <stack>
-#include <map>
 #include <algorithm>
 #include <cctype>
-#include <queue>
 
 GtkWindow *window;
 GtkEntry *entry;
@@ -21,236 +18,159 @@ GtkButton *newton_button;
 GtkLabel *variable_label;
 GtkEntry *variable_entry;
 GtkEntry *initial_guess_entry;
+GtkEntry *search_from_entry;
+GtkEntry *search_to_entry;
 
 
+// Owns every node built for the current expression and its derivatives
+ExpressionArena expression_arena;
 const Expression* parsed_expression = nullptr;
+// Values of the variables the expression is evaluated with
+EvalContext eval_context;
+// Why the last parse_expression call failed
+std::string parse_error;
 
 
-const Expression* construct_expression_from_rpn(std::queue<std::string>& rpn) {
-    std::stack<const Expression*> expressionStack;
-    while (!rpn.empty()) {
-        std::string token = rpn.front();
-        std::cout << token << " ";
-        rpn.pop();
-
-        if (token.front() == '(' && token.back() == ')') {
-            std::string number = token.substr(1, token.length() - 2);
-
-            if (std::isdigit(number[0]) || (number[0] == '-' && number.length() > 1 && std::isdigit(number[1]))) {
-                expressionStack.push(new Constant(std::stoll(number)));
-            } else {
-                return nullptr;
-            }
-        } else if (std::isdigit(token[0]) || (token[0] == '-' && token.length() > 1 && std::isdigit(token[1]))) {
-            // Number
-            expressionStack.push(new Constant(std::stoll(token)));
-        } else if (token == "e") {
-            expressionStack.push(Constant::e);
-        } else if (token == "pi") {
-            expressionStack.push(Constant::pi);
-        } else if (token == "sin" || token == "cos" || token == "tan" || token == "sqrt" || token == "ln" || token == "lg") {
-            if (expressionStack.empty()) {
-                return nullptr;
-            }
-            const Expression* operand = expressionStack.top();
-            expressionStack.pop();
-
-            if (token == "sin") {
-                expressionStack.push(new ElementaryFunctions::Sin(operand));
-            } else if (token == "cos") {
-                expressionStack.push(new ElementaryFunctions::Cos(operand));
-            } else if (token == "tan") {
-                expressionStack.push(new ElementaryFunctions::Tan(operand));
-            } else if (token == "sqrt") {
-                expressionStack.push(new ElementaryFunctions::Power(operand, new operators::Fraction(Constant::ONE, new Constant(2))));
-            } else if (token == "ln") {
-                expressionStack.push(new ElementaryFunctions::Log(Constant::e, operand));
-            } else if (token == "lg") {
-                expressionStack.push(new ElementaryFunctions::Log(new Constant(10), operand));
-            } 
-        } else if (token == "+" || token == "-" || token == "*" || token == "/" || token == "^") {
-            // Binary Operator
-            if (expressionStack.size() < 2) {
-                return nullptr;
-            }
-            const Expression* rhs = expressionStack.top();
-            expressionStack.pop();
-            const Expression* lhs = expressionStack.top();
-            expressionStack.pop();
-            if (token == "^") {
-                if (!hasVariables(rhs)){
-                    expressionStack.push(new ElementaryFunctions::Power(lhs, rhs));
-                }
-                else if (!hasVariables(lhs)){
-                    expressionStack.push(new ElementaryFunctions::Exp(lhs, rhs));
-                }
-            }
-            else if (token == "/") {
-                expressionStack.push(new operators::Fraction(lhs, rhs));
-            }
-            else if (token == "*") {
-                expressionStack.push(new operators::Product({lhs, rhs}));
-            } else if (token == "-") {
-                expressionStack.push(new operators::Sum({lhs, new operators::Product({new Constant(-1), rhs})}));
-            } else if (token == "+") {
-                expressionStack.push(new operators::Sum({lhs, rhs}));
-            }
-        } else {
-            // Variable
-            expressionStack.push(new Variable(token));
-        }
-    }
-
-    if (expressionStack.size() != 1) {
-        return nullptr;
-    }
-
-    return expressionStack.top();
+void reset_expression_arena() {
+    parsed_expression = nullptr;
+    eval_context = EvalContext();
+    expression_arena.reset();
 }
 
-const Expression* parse_expression(const std::string& input) {
-    std::cout << input << "\n";
-    std::istringstream iss(input);
-    std::stack<std::string> operatorStack;
-    std::queue<std::string> outputQueue;
-    std::map<std::string, int> operatorPrecedence{
-        {"^", 1},
-        {"*", 2}, {"/", 2},
-        {"+", 3}, {"-", 3},
-        {"=", 4}
-    };
-
-    std::string token;
-    while (iss >> token) {
-        if (token == "(") {
-            operatorStack.push(token);
-        } 
-        else if (token == ")") {
-            while (!operatorStack.empty() && operatorStack.top() != "(") {
-                outputQueue.push(operatorStack.top());
-                operatorStack.pop();
-            }
-            if (operatorStack.empty() || operatorStack.top() != "(") {
-                return nullptr;
-            }
-            operatorStack.pop();
-        } 
-        else if (operatorPrecedence.find(token) != operatorPrecedence.end()) { 
-            while (!operatorStack.empty() && operatorPrecedence[operatorStack.top()] < operatorPrecedence[token]) {
-                outputQueue.push(operatorStack.top());
-                operatorStack.pop();
-            }
-            operatorStack.push(token);
-        } 
-        else {
-            outputQueue.push(token);
-        }
-    }
-
 
-    while (!operatorStack.empty()) {
-        if (operatorStack.top() == "(" || operatorStack.top() == ")") {
-            return nullptr; // Mismatched parentheses
-        }
-        outputQueue.push(operatorStack.top());
-        operatorStack.pop();
+const Expression* parse_expression(const std::string& input) {
+    try {
+        parse_error.clear();
+        return Parser::parse(input);
+    } catch (const ParseError& error) {
+        parse_error = error.what();
+        return nullptr;
     }
-
-    return construct_expression_from_rpn(outputQueue);
 }
 
 
 void update_output_label(const Expression* expr) {
     if (expr) {
-        std::string output = "Result: " + std::to_string(expr->calculate());
+        std::string output = "Result: " + std::to_string(expr->calculate(eval_context));
         gtk_label_set_text(output_label, output.c_str());
     } else {
-        gtk_label_set_text(output_label, "Invalid expression");
+        gtk_label_set_text(output_label, ("Invalid expression: " + parse_error).c_str());
     }
 }
 
 
 void on_calculate_button_clicked(GtkButton *button, gpointer user_data) {
+    reset_expression_arena();
+    ExpressionArena::Scope scope(expression_arena);
+
     const char *input_text = gtk_editable_get_text(GTK_EDITABLE (entry));
     std::string input(input_text);
 
     const char *variable_text = gtk_editable_get_text(GTK_EDITABLE (variable_entry));
     std::string variable(variable_text);
 
-    Variable::variables[variable] = new Constant(0);
+    eval_context.set(variable, 0);
 
-    if (parsed_expression != nullptr) {
-        delete parsed_expression;
-    }
     parsed_expression = parse_expression(input);
     update_output_label(parsed_expression);
 }
 
 
-void on_find_max_button_clicked(GtkButton *button, gpointer user_data) {
-    if (parsed_expression != nullptr) {
-        const char *variable_text = gtk_editable_get_text(GTK_EDITABLE (variable_entry)); 
-        std::string variable(variable_text);
-        
-        const Expression* derivative = parsed_expression->complex_derivative(variable);
-        if (derivative != nullptr && hasVariables(derivative)) {
-            const Expression* root = NewtonMethod::Newton_root(derivative, variable, 0); 
-            if (root) {
-                Variable::variables[variable] = root;
-                double max_value = parsed_expression->calculate();
-                std::string output = "Maximum value: " + std::to_string(max_value);
-                gtk_label_set_text(output_label, output.c_str());
-                delete root;
-            } else {
-                gtk_label_set_text(output_label, "Failed to find a maximum.");
-            }
-            delete derivative;
-        } else {
-            gtk_label_set_text(output_label, "Expression is not a function of the variable or derivative failed.");
+// Search interval for Find Max / Find Min, [-10, 10] when left empty
+bool read_search_interval(double& lo, double& hi) {
+    const char *from_text = gtk_editable_get_text(GTK_EDITABLE (search_from_entry));
+    const char *to_text = gtk_editable_get_text(GTK_EDITABLE (search_to_entry));
+    lo = -10;
+    hi = 10;
+    char *end = nullptr;
+    if (*from_text != '\0') {
+        lo = std::strtod(from_text, &end);
+        if (*end != '\0') {
+            return false;
         }
-    } else {
-        gtk_label_set_text(output_label, "No expression parsed");
     }
+    if (*to_text != '\0') {
+        hi = std::strtod(to_text, &end);
+        if (*end != '\0') {
+            return false;
+        }
+    }
+    return std::isfinite(lo) && std::isfinite(hi) && lo <= hi;
 }
 
+std::string describe_extremum(const std::string& name, const std::string& variable, const Extremum& extremum) {
+    std::ostringstream output;
+    output.precision(12);
+    output << name << " value: " << extremum.value << " at " << variable << " = " << extremum.argument;
+    switch (extremum.kind) {
+        case Extremum::Kind::Endpoint:
+            output << " (endpoint)";
+            break;
+        case Extremum::Kind::Minimum:
+            output << " (local minimum, f'' = " << extremum.second_derivative << ")";
+            break;
+        case Extremum::Kind::Maximum:
+            output << " (local maximum, f'' = " << extremum.second_derivative << ")";
+            break;
+        case Extremum::Kind::Flat:
+            output << " (f'' = 0, higher order)";
+            break;
+    }
+    output << "\nCertified within [" << extremum.bound.lo << ", " << extremum.bound.hi << "]";
+    return output.str();
+}
 
-void on_find_min_button_clicked(GtkButton *button, gpointer user_data) {
-    if (parsed_expression != nullptr) {
-        const char *variable_text = gtk_editable_get_text(GTK_EDITABLE (variable_entry)); 
-        std::string variable(variable_text);
-        
-        const Expression* derivative = parsed_expression->complex_derivative(variable);
-        if (derivative != nullptr && hasVariables(derivative)) {
-            const Expression* root = NewtonMethod::Newton_root(derivative, variable, 0); 
-            if (root) {
-                Variable::variables[variable] = root;
-                double min_value = parsed_expression->calculate();
-                std::string output = "Minimum value: " + std::to_string(min_value);
-                gtk_label_set_text(output_label, output.c_str());
-                delete root;
-            } else {
-                gtk_label_set_text(output_label, "Failed to find a minimum.");
-            }
-            delete derivative;
-        } else {
-            gtk_label_set_text(output_label, "Expression is not a function of the variable or derivative failed.");
-        }
-    } else {
+void find_extremum(bool maximum) {
+    ExpressionArena::Scope scope(expression_arena);
+
+    if (parsed_expression == nullptr) {
         gtk_label_set_text(output_label, "No expression parsed");
+        return;
     }
+    const char *variable_text = gtk_editable_get_text(GTK_EDITABLE (variable_entry)); 
+    std::string variable(variable_text);
+
+    double lo, hi;
+    if (!read_search_interval(lo, hi)) {
+        gtk_label_set_text(output_label, "Invalid search interval.");
+        return;
+    }
+
+    Extremum extremum = maximum ? GlobalOptimizer::find_maximum(parsed_expression, variable, lo, hi)
+                                : GlobalOptimizer::find_minimum(parsed_expression, variable, lo, hi);
+    if (extremum.found) {
+        std::string output = describe_extremum(maximum ? "Maximum" : "Minimum", variable, extremum);
+        gtk_label_set_text(output_label, output.c_str());
+    } else {
+        gtk_label_set_text(output_label, maximum ? "The function is unbounded above or undefined on the interval."
+                                                 : "The function is unbounded below or undefined on the interval.");
+    }
+}
+
+void on_find_max_button_clicked(GtkButton *button, gpointer user_data) {
+    find_extremum(true);
+}
+
+
+void on_find_min_button_clicked(GtkButton *button, gpointer user_data) {
+    find_extremum(false);
 }
 
 
 void on_taylor_button_clicked(GtkButton *button, gpointer user_data) {
+    ExpressionArena::Scope scope(expression_arena);
+
     if (parsed_expression != nullptr) {
         const char *variable_text = gtk_editable_get_text(GTK_EDITABLE (variable_entry)); 
         std::string variable(variable_text);
         
-        // TODO: Implement logic to generate the Taylor series representation.
         const Expression* taylor = Taylor_series(parsed_expression, variable, 0);
-        std::string output = "Taylor series: " + taylor->to_string();
-        gtk_label_set_text(output_label, output.c_str());
-        delete taylor;
+        if (taylor != nullptr) {
+            std::string output = "Taylor series: " + taylor->to_string();
+            gtk_label_set_text(output_label, output.c_str());
+        } else {
+            gtk_label_set_text(output_label, "The function is not analytic at 0.");
+        }
     } else {
         gtk_label_set_text(output_label, "No expression parsed");
     }
@@ -258,6 +178,9 @@ void on_taylor_button_clicked(GtkButton *button, gpointer user_data) {
 
 
 void on_newton_button_clicked(GtkButton *button, gpointer user_data) {
+    reset_expression_arena();
+    ExpressionArena::Scope scope(expression_arena);
+
     const char *input_text = gtk_editable_get_text(GTK_EDITABLE (entry));
     std::string input(input_text);
 
@@ -265,30 +188,51 @@ void on_newton_button_clicked(GtkButton *button, gpointer user_data) {
     std::string variable(variable_text);
 
     const char *initial_guess_text = gtk_editable_get_text(GTK_EDITABLE (initial_guess_entry));
-    double initial_guess = std::stod(initial_guess_text);
+    std::string initial_guess_input(initial_guess_text);
 
-    std::cout << variable << "\n";
+    eval_context.set(variable, 0);
 
-    Variable::variables[variable] = new Constant(0); 
-
-    if (parsed_expression != nullptr) {
-        delete parsed_expression;
-    }
     parsed_expression = parse_expression(input);
 
-    if (parsed_expression) {
+    if (parsed_expression && initial_guess_input.empty()) {
+        // No guess: every root in the search interval
+        double lo, hi;
+        if (!read_search_interval(lo, hi)) {
+            gtk_label_set_text(output_label, "Invalid search interval.");
+            return;
+        }
+        std::vector<double> roots = RootFinder::find_roots(parsed_expression, variable, lo, hi);
+        std::ostringstream output;
+        output.precision(12);
+        if (roots.empty()) {
+            output << "No roots in [" << lo << ", " << hi << "]";
+        } else {
+            output << roots.size() << (roots.size() == 1 ? " root" : " roots") << " in [" << lo << ", " << hi << "]:";
+            for (double root : roots) {
+                output << "\n" << variable << " = " << root;
+            }
+        }
+        gtk_label_set_text(output_label, output.str().c_str());
+    }
+    else if (parsed_expression) {
+        double initial_guess;
+        try {
+            initial_guess = std::stod(initial_guess_input);
+        } catch (const std::exception&) {
+            gtk_label_set_text(output_label, "Invalid initial guess.");
+            return;
+        }
         const Expression* root = NewtonMethod::Newton_root(parsed_expression, variable, initial_guess);
         if (root != nullptr) {
             std::string output = "Root found: " + root->to_string();
             gtk_label_set_text(output_label, output.c_str());
-            delete root;
         }
         else {
             gtk_label_set_text(output_label, "Newton's method failed to converge.");
         }
     }
     else {
-        gtk_label_set_text(output_label, "Invalid expression");
+        gtk_label_set_text(output_label, ("Invalid expression: " + parse_error).c_str());
     }
 }
 
@@ -345,9 +289,17 @@ void activate(GtkApplication* app, gpointer user_data) {
 
     // Create the initial guess entry
     initial_guess_entry = GTK_ENTRY(gtk_entry_new());
-    gtk_entry_set_placeholder_text(initial_guess_entry, "Initial Guess");
+    gtk_entry_set_placeholder_text(initial_guess_entry, "Initial Guess (empty: all roots)");
     gtk_box_append(vbox, GTK_WIDGET(initial_guess_entry));
 
+    // Create the search interval entries for Find Max / Find Min
+    search_from_entry = GTK_ENTRY(gtk_entry_new());
+    gtk_entry_set_placeholder_text(search_from_entry, "Search from (-10)");
+    gtk_box_append(vbox, GTK_WIDGET(search_from_entry));
+    search_to_entry = GTK_ENTRY(gtk_entry_new());
+    gtk_entry_set_placeholder_text(search_to_entry, "Search to (10)");
+    gtk_box_append(vbox, GTK_WIDGET(search_to_entry));
+
     // Set the box container as the child of the window
     gtk_window_set_child(window, GTK_WIDGET(vbox));
 
@@ -7,14 +7,11 @@
 #include <gtk/gtk.h>
 
 #include <sstream>
-#include <stack>
-#include <map>
 #include <algorithm>
 #include <cctype>
-#include <queue>
 
 int run(int argc, char *argv[]);
-const Expression* construct_expression_from_rpn(std::queue<std::string>& rpn);
+// Null on a syntax error
 const Expression* parse_expression(const std::string& input);
 
 #endif //TUNGSTENBETA_GUI
\ No newline at end of file
@@ -3,23 +3,24 @@
 
 
 // Variable
-std::unordered_map<std::string, const Expression*> Variable::variables;
-
-Variable::Variable(const std::string& name){
+Variable::Variable(const std::string& name) : Expression(ExprKind::Variable){
     name_ = name;
+    slot_ = EvalContext::slot_of(name);
 }
 
-double Variable::calculate() const{
-    auto it = Variable::variables.find(name_);
-    if (it != variables.end()){
-        return it->second->calculate();
-    }
-    else{
-        return 0;
-    }
+double Variable::calculate(const EvalContext& context) const{
+    return context.get(slot_);
+}
+
+Dual Variable::calculate_dual(const EvalContext& context, int slot) const{
+    return Dual{context.get(slot_), slot_ == slot ? 1.0 : 0.0};
+}
+
+Interval Variable::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return slot_ == slot ? range : Interval::point(context.get(slot_));
 }
 
-const Expression* Variable::complex_derivative(const std::string& variable) const{
+const Expression* Variable::compute_derivative(const std::string& variable) const{
     if (variable == name_){
         return Constant::ONE;
     } 
@@ -28,23 +29,34 @@ const Expression* Variable::complex_derivative(const std::string& variable) cons
     }
 }
 
-const Expression* Variable::plug_variable(const std::string& variable) const{
+const Expression* Variable::plug_variable(const std::string& variable, const Expression* value) const{
     if (variable == name_){
-        return Variable::variables[name_];
+        return value;
     } 
     else{
         return this;
     }
 }
 
-const Expression* Variable::copy() const{
-    return new Variable(name_);
-}
-
-const Expression* Variable::simplify() const{
+const Expression* Variable::compute_simplify() const{
     return this;
 }
 
 std::string Variable::to_string() const{
     return name_;
+}
+
+bool Variable::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Variable){
+        return false;
+    }
+    const Variable* variable = static_cast<const Variable*>(&other);
+    return variable->name_ == name_;
+}
+
+size_t Variable::compute_hash() const{
+    return combine_hash(string_hash("Variable"), string_hash(name_));
 }
\ No newline at end of file
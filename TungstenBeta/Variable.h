@@ -5,23 +5,27 @@
 
 class Variable : public Expression{
 public:
-    // Список(словарь) всех переменных и их значений
-    static std::unordered_map<std::string, const Expression*> variables;
-
     Variable(const std::string& name);
 
-    double calculate() const override;
+    double calculate(const EvalContext& context) const override;
+    Dual calculate_dual(const EvalContext& context, int slot) const override;
+    Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
     std::string get_name() const { return name_; };
+    int get_slot() const { return slot_; };
 
-    const Expression* plug_variable(const std::string& variable) const override;
-    const Expression* complex_derivative(const std::string& variable) const override;
-    const Expression* simplify() const override;
+    const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
 
-    const Expression* copy() const override;
     std::string to_string() const override;
+    bool equals(const Expression& other) const override;
 
     private:
     std::string name_;
+    // Slot of name_ in EvalContext
+    int slot_;
+
+    size_t compute_hash() const override;
+    const Expression* compute_simplify() const override;
+    const Expression* compute_derivative(const std::string& variable) const override;
 };
 
 
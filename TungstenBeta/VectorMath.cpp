@@ -0,0 +1,420 @@
+#include "VectorMath.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__) && !defined(__clang__)
+#define VECTOR_MATH_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define VECTOR_MATH_CLONES
+#endif
+
+namespace{
+    // Adding then subtracting 1.5 * 2^52 rounds to the nearest integer and
+    // leaves that integer in the low mantissa bits.
+    const double ROUND_MAGIC = 6755399441055744.0;
+
+    inline uint64_t bits_of(double x){
+        uint64_t u;
+        std::memcpy(&u, &x, sizeof(u));
+        return u;
+    }
+
+    inline double double_of(uint64_t u){
+        double x;
+        std::memcpy(&x, &u, sizeof(x));
+        return x;
+    }
+
+    inline double exp_kernel(double x){
+        const double LOG2E = 1.4426950408889634;
+        const double LN2_HI = 6.93147180369123816490e-01;
+        const double LN2_LO = 1.90821492927058770002e-10;
+
+        double clamped = x < -746.0 ? -746.0 : (x > 710.0 ? 710.0 : x);
+        double t = clamped * LOG2E + ROUND_MAGIC;
+        int64_t k = static_cast<int64_t>(bits_of(t) - bits_of(ROUND_MAGIC));
+        double kd = t - ROUND_MAGIC;
+        double r = (clamped - kd * LN2_HI) - kd * LN2_LO;
+
+        // Taylor series of e^r on |r| <= ln(2) / 2
+        double p = 1.0 / 6227020800.0;
+        p = p * r + 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 0.5;
+        p = p * r + 1.0;
+        p = p * r + 1.0;
+
+        // 2^k in two steps so that k = 1024 and subnormal results work
+        int64_t k1 = k >> 1;
+        int64_t k2 = k - k1;
+        double result = p * double_of(static_cast<uint64_t>(k1 + 1023) << 52) * double_of(static_cast<uint64_t>(k2 + 1023) << 52);
+        return x != x ? x : result;
+    }
+
+    inline double log_kernel(double x){
+        const double LN2_HI = 6.93147180369123816490e-01;
+        const double LN2_LO = 1.90821492927058770002e-10;
+        const double SQRT2 = 1.4142135623730951;
+
+        uint64_t u = bits_of(x);
+        // Biased exponent converted to double through the same magic number trick
+        double e = double_of(0x4330000000000000ULL | (u >> 52)) - 4503599627370496.0 - 1023.0;
+        double m = double_of((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+        bool high = m > SQRT2;
+        m = high ? m * 0.5 : m;
+        e = high ? e + 1.0 : e;
+
+        // log(m) = 2 * atanh(s), s = (m - 1) / (m + 1), |s| < 0.172
+        double s = (m - 1.0) / (m + 1.0);
+        double s2 = s * s;
+        double p = 1.0 / 21.0;
+        p = p * s2 + 1.0 / 19.0;
+        p = p * s2 + 1.0 / 17.0;
+        p = p * s2 + 1.0 / 15.0;
+        p = p * s2 + 1.0 / 13.0;
+        p = p * s2 + 1.0 / 11.0;
+        p = p * s2 + 1.0 / 9.0;
+        p = p * s2 + 1.0 / 7.0;
+        p = p * s2 + 1.0 / 5.0;
+        p = p * s2 + 1.0 / 3.0;
+        double logm = 2.0 * s + 2.0 * s * s2 * p;
+        return e * LN2_HI + (logm + e * LN2_LO);
+    }
+
+    // Error-free sum and product: the rounded result plus its exact error.
+    // The product splits its operands (Dekker) rather than using fma, which
+    // the default clone would call in software.
+    inline void two_sum(double a, double b, double& sum, double& error){
+        sum = a + b;
+        double bv = sum - a;
+        error = (a - (sum - bv)) + (b - bv);
+    }
+
+    inline void split(double a, double& hi, double& lo){
+        double t = 134217729.0 * a;
+        hi = t - (t - a);
+        lo = a - hi;
+    }
+
+    inline void two_product(double a, double b, double& product, double& error){
+        double ah, al, bh, bl;
+        split(a, ah, al);
+        split(b, bh, bl);
+        product = a * b;
+        error = ((ah * bh - product) + ah * bl + al * bh) + al * bl;
+    }
+
+    // log(x) as hi + lo, about 20 bits beyond log_kernel. pow needs them:
+    // the error of the logarithm is multiplied by the exponent, and e^y
+    // turns an absolute error in y into a relative one.
+    inline void log_kernel_extended(double x, double& hi, double& lo){
+        const double LN2_HI = 6.93147180369123816490e-01;
+        const double LN2_LO = 1.90821492927058770002e-10;
+        const double SQRT2 = 1.4142135623730951;
+
+        uint64_t u = bits_of(x);
+        double e = double_of(0x4330000000000000ULL | (u >> 52)) - 4503599627370496.0 - 1023.0;
+        double m = double_of((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+        bool high = m > SQRT2;
+        m = high ? m * 0.5 : m;
+        e = high ? e + 1.0 : e;
+
+        // s = (m - 1) / (m + 1) with the rounding of the division kept in
+        // s_lo; m - 1 is exact on [sqrt(2) / 2, sqrt(2)]
+        double f = m - 1.0;
+        double d, d_lo;
+        two_sum(m, 1.0, d, d_lo);
+        double s = f / d;
+        double q, q_lo;
+        two_product(s, d, q, q_lo);
+        double s_lo = (((f - q) - q_lo) - s * d_lo) / d;
+
+        // s^3 as cube + cube_lo, then 2 * s^3 / 3: at up to 0.0034 it is
+        // too large to round into lo
+        const double TWO_THIRDS = 0.66666666666666663;
+        const double TWO_THIRDS_LO = 3.7007434154171886e-17;
+        double s2, s2_lo;
+        two_product(s, s, s2, s2_lo);
+        double cube, cube_lo;
+        two_product(s, s2, cube, cube_lo);
+        cube_lo += s * s2_lo;
+        double third, third_lo;
+        two_product(cube, TWO_THIRDS, third, third_lo);
+        third_lo += cube_lo * TWO_THIRDS + cube * TWO_THIRDS_LO;
+
+        // The rest of the series, from 2 * s^5 / 5
+        double p = 1.0 / 21.0;
+        p = p * s2 + 1.0 / 19.0;
+        p = p * s2 + 1.0 / 17.0;
+        p = p * s2 + 1.0 / 15.0;
+        p = p * s2 + 1.0 / 13.0;
+        p = p * s2 + 1.0 / 11.0;
+        p = p * s2 + 1.0 / 9.0;
+        p = p * s2 + 1.0 / 7.0;
+        p = p * s2 + 1.0 / 5.0;
+
+        // e * LN2_HI is exact; s_lo enters through the derivative 2 + 2 * s^2
+        double error;
+        two_sum(e * LN2_HI, 2.0 * s, hi, lo);
+        two_sum(hi, third, hi, error);
+        lo += error + third_lo + 2.0 * cube * s2 * p + 2.0 * s_lo * (1.0 + s2) + e * LN2_LO;
+    }
+
+    // a^b = e^(b * log(a)) with the product carried as hi + lo, so the
+    // result stays within a few ulp when |b * log(a)| is large
+    inline double pow_kernel(double a, double b){
+        double hi, lo;
+        log_kernel_extended(a, hi, lo);
+        double y, y_lo;
+        two_product(b, hi, y, y_lo);
+        y_lo += b * lo;
+        double y_hi = y + y_lo;
+        y_lo = y_lo - (y_hi - y);
+        // e^(y_hi + y_lo) = e^y_hi * (1 + y_lo); multiplying by the sum
+        // keeps overflowed results infinite
+        return exp_kernel(y_hi) * (1.0 + y_lo);
+    }
+
+    inline bool log_fast_path(double x){
+        return x >= 2.2250738585072014e-308 && x <= 1.7976931348623157e308;
+    }
+
+    // Exponents pow_kernel cannot split without overflow, and infinities
+    // and NaN, whose special cases (1^inf = 1) it does not know
+    inline bool pow_fast_path(double a, double b){
+        return log_fast_path(a) && std::fabs(b) < 1e300;
+    }
+
+    // Reduces x by multiples of pi / 2; quadrant receives the multiple
+    inline double reduce_half_pi(double x, int64_t& quadrant){
+        const double TWO_OVER_PI = 6.36619772367581382433e-01;
+        const double PIO2_1 = 1.57079632673412561417e+00;
+        const double PIO2_2 = 6.07710050630396597660e-11;
+        const double PIO2_3 = 2.02226624871116645580e-21;
+
+        double t = x * TWO_OVER_PI + ROUND_MAGIC;
+        quadrant = static_cast<int64_t>(bits_of(t) - bits_of(ROUND_MAGIC));
+        double q = t - ROUND_MAGIC;
+        return ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+    }
+
+    inline double sin_poly(double r){
+        double r2 = r * r;
+        double p = -1.0 / 355687428096000.0;
+        p = p * r2 + 1.0 / 1307674368000.0;
+        p = p * r2 - 1.0 / 6227020800.0;
+        p = p * r2 + 1.0 / 39916800.0;
+        p = p * r2 - 1.0 / 362880.0;
+        p = p * r2 + 1.0 / 5040.0;
+        p = p * r2 - 1.0 / 120.0;
+        p = p * r2 + 1.0 / 6.0;
+        return r - r * r2 * p;
+    }
+
+    inline double cos_poly(double r){
+        double r2 = r * r;
+        double p = 1.0 / 6402373705728000.0;
+        p = p * r2 - 1.0 / 20922789888000.0;
+        p = p * r2 + 1.0 / 87178291200.0;
+        p = p * r2 - 1.0 / 479001600.0;
+        p = p * r2 + 1.0 / 3628800.0;
+        p = p * r2 - 1.0 / 40320.0;
+        p = p * r2 + 1.0 / 720.0;
+        p = p * r2 - 1.0 / 24.0;
+        p = p * r2 + 0.5;
+        return 1.0 - r2 * p;
+    }
+
+    // sin(x) = [s, c, -s, -c][q mod 4], cos(x) = [c, -s, -c, s][q mod 4]
+    inline double sin_kernel(double x){
+        int64_t q;
+        double r = reduce_half_pi(x, q);
+        double s = sin_poly(r);
+        double c = cos_poly(r);
+        double v = (q & 1) ? c : s;
+        return (q & 2) ? -v : v;
+    }
+
+    inline double cos_kernel(double x){
+        int64_t q;
+        double r = reduce_half_pi(x, q);
+        double s = sin_poly(r);
+        double c = cos_poly(r);
+        double v = (q & 1) ? -s : c;
+        return (q & 2) ? -v : v;
+    }
+
+    inline double tan_kernel(double x){
+        int64_t q;
+        double r = reduce_half_pi(x, q);
+        double s = sin_poly(r);
+        double c = cos_poly(r);
+        // tan has period pi: odd quadrants give -cot(r)
+        return (q & 1) ? -c / s : s / c;
+    }
+
+    inline bool trig_fast_path(double x){
+        return std::fabs(x) < 1.0e6;
+    }
+}
+
+namespace VectorMath{
+
+VECTOR_MATH_CLONES
+void add(const double* a, const double* b, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = a[i] + b[i];
+    }
+}
+
+VECTOR_MATH_CLONES
+void mul(const double* a, const double* b, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = a[i] * b[i];
+    }
+}
+
+VECTOR_MATH_CLONES
+void div(const double* a, const double* b, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = a[i] / b[i];
+    }
+}
+
+VECTOR_MATH_CLONES
+void scale(const double* a, double k, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = a[i] * k;
+    }
+}
+
+VECTOR_MATH_CLONES
+void exp(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = exp_kernel(x[i]);
+    }
+}
+
+VECTOR_MATH_CLONES
+void log(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = log_kernel(x[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!log_fast_path(x[i])){
+            out[i] = std::log(x[i]);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void sin(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = sin_kernel(x[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!trig_fast_path(x[i])){
+            out[i] = std::sin(x[i]);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void cos(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = cos_kernel(x[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!trig_fast_path(x[i])){
+            out[i] = std::cos(x[i]);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void tan(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = tan_kernel(x[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!trig_fast_path(x[i])){
+            out[i] = std::tan(x[i]);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void cot(const double* x, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = 1.0 / tan_kernel(x[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!trig_fast_path(x[i])){
+            out[i] = 1 / std::tan(x[i]);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void pow_const(const double* a, double p, double* out, size_t n){
+    if (p == std::floor(p) && std::fabs(p) <= 64){
+        // Integer exponent: square-and-multiply with the same steps in every lane
+        const size_t CHUNK = 256;
+        long long e = static_cast<long long>(std::fabs(p));
+        for (size_t start = 0; start < n; start += CHUNK){
+            size_t m = (n - start < CHUNK) ? n - start : CHUNK;
+            double base[CHUNK];
+            double result[CHUNK];
+            for (size_t i = 0; i < m; ++i){
+                base[i] = a[start + i];
+                result[i] = 1.0;
+            }
+            for (long long k = e; k > 0; k >>= 1){
+                if (k & 1){
+                    for (size_t i = 0; i < m; ++i){
+                        result[i] *= base[i];
+                    }
+                }
+                for (size_t i = 0; i < m; ++i){
+                    base[i] *= base[i];
+                }
+            }
+            for (size_t i = 0; i < m; ++i){
+                out[start + i] = p < 0 ? 1.0 / result[i] : result[i];
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i){
+        out[i] = pow_kernel(a[i], p);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!pow_fast_path(a[i], p)){
+            out[i] = std::pow(a[i], p);
+        }
+    }
+}
+
+VECTOR_MATH_CLONES
+void pow(const double* a, const double* b, double* out, size_t n){
+    for (size_t i = 0; i < n; ++i){
+        out[i] = pow_kernel(a[i], b[i]);
+    }
+    for (size_t i = 0; i < n; ++i){
+        if (!pow_fast_path(a[i], b[i])){
+            out[i] = std::pow(a[i], b[i]);
+        }
+    }
+}
+}
@@ -0,0 +1,31 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <cstddef>
+
+// Element-wise math over arrays, written without branches in the hot loops
+// so that the compiler vectorizes them. On x86-64 an AVX2 clone is selected
+// at load time when the CPU supports it. Accuracy is within a few ulp of
+// the standard library; arguments the fast paths do not cover (negative or
+// subnormal logarithm arguments, trigonometric arguments beyond ~1e6) are
+// recomputed with <cmath>.
+namespace VectorMath{
+    void add(const double* a, const double* b, double* out, size_t n);
+    void mul(const double* a, const double* b, double* out, size_t n);
+    void div(const double* a, const double* b, double* out, size_t n);
+    void scale(const double* a, double k, double* out, size_t n);
+
+    void exp(const double* x, double* out, size_t n);
+    void log(const double* x, double* out, size_t n);
+    void sin(const double* x, double* out, size_t n);
+    void cos(const double* x, double* out, size_t n);
+    void tan(const double* x, double* out, size_t n);
+    void cot(const double* x, double* out, size_t n);
+
+    // a^p for a constant exponent
+    void pow_const(const double* a, double p, double* out, size_t n);
+    // a^b element-wise
+    void pow(const double* a, const double* b, double* out, size_t n);
+}
+
+#endif // VECTOR_MATH_H
@@ -1,46 +1,96 @@
 #include "operators.h"
 
 #include "Constant.h"
+#include "ExpressionFactory.h"
 #include "ElementaryFunctions.h"
+#include "Polynomial.h"
 
 namespace operators{
 
+namespace{
+    // e and pi are Constants too, but have no exact value
+    bool is_exact_constant(const Expression* expr){
+        return (expr->kind() == ExprKind::Constant) && (expr != Constant::e) && (expr != Constant::pi);
+    }
+
+    // Splits c * X into the exact coefficient c and the rest X
+    std::pair<Rational, const Expression*> split_coefficient(const Expression* term){
+        if (term->kind() == ExprKind::Product){
+            std::vector<const Expression*> factors = static_cast<const Product*>(term)->get_factors();
+            if (factors.size() > 1 && is_exact_constant(factors[0])){
+                const Rational& coefficient = static_cast<const Constant*>(factors[0])->get_value();
+                if (factors.size() == 2){
+                    return {coefficient, factors[1]};
+                }
+                return {coefficient, ExpressionFactory::make_product(std::vector<const Expression*>(factors.begin() + 1, factors.end()))};
+            }
+        }
+        return {1, term};
+    }
+
+    const Expression* with_coefficient(const Rational& coefficient, const Expression* term){
+        std::vector<const Expression*> factors = {ExpressionFactory::make_constant(coefficient)};
+        if (term->kind() == ExprKind::Product){
+            for (const Expression* factor : static_cast<const Product*>(term)->get_factors()){
+                factors.push_back(factor);
+            }
+        }
+        else{
+            factors.push_back(term);
+        }
+        return ExpressionFactory::make_product(std::move(factors));
+    }
+}
+
 // Sum
-Sum::Sum(std::vector<const Expression*>&& terms){
+Sum::Sum(std::vector<const Expression*>&& terms) : Expression(ExprKind::Sum){
     terms_ = terms;
 }
 
-Sum::~Sum(){
-    if (terms_.size()){
-        for (const Expression* term : terms_){
-            delete term;
-        }
-    }    
-}
+Sum::~Sum() = default;
+
+double Sum::calculate(const EvalContext& context) const{
+    double result = 0;
 
-const Expression* Sum::copy() const{
-    std::vector<const Expression*> clonedTerms;
     for (const Expression* term : terms_){
-        clonedTerms.push_back(term);
+        result += term->calculate(context);
     }
-    return (new Sum(std::move(clonedTerms)))->simplify();
-}
 
-double Sum::calculate() const{
-    double result = 0;
+    return result;
+}
 
+Dual Sum::calculate_dual(const EvalContext& context, int slot) const{
+    Dual result{0, 0};
     for (const Expression* term : terms_){
-        result += term->calculate();
+        result = result + term->calculate_dual(context, slot);
     }
+    return result;
+}
 
+Interval Sum::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    if (terms_.empty()){
+        return Interval::point(0);
+    }
+    Interval result = terms_[0]->calculate_interval(context, slot, range);
+    for (size_t i = 1; i < terms_.size(); ++i){
+        result = result + terms_[i]->calculate_interval(context, slot, range);
+    }
     return result;
 }
 
-const Expression* Sum::simplify() const{
+const Expression* Sum::compute_simplify() const{
+    // Polynomial subtrees (over any atoms) go through the exact canonical
+    // form. Nested sums enter it already simplified, so each is expanded
+    // once, and a sum that failed stops every sum holding it.
+    Polynomial polynomial;
+    if (Polynomial::from_expression(this, polynomial)){
+        return polynomial.to_expression();
+    }
+
     std::vector<const Expression*> openedTerms;
     std::vector<const Expression*> simplifiedTerms;
-    std::unordered_map<std::string, const Expression*> coefficients;
-    int constantTerm = 0;
+    std::unordered_map<const Expression*, Rational, ExpressionHash, ExpressionEqual> coefficients;
+    Rational constantTerm = 0;
 
     for (const Expression* term : terms_){
         const Expression* simplifiedTerm = term->simplify();
@@ -48,36 +98,53 @@ const Expression* Sum::simplify() const{
         if (simplifiedTerm == Constant::ZERO){
             continue;
         }
-        if (typeid(*simplifiedTerm) == typeid(Constant)){
-            constantTerm += static_cast<const Constant*>(simplifiedTerm)->get_exact_value();
+        if (is_exact_constant(simplifiedTerm)){
+            constantTerm += static_cast<const Constant*>(simplifiedTerm)->get_value();
         }
-        else if (typeid(*simplifiedTerm) == typeid(Sum)){
+        else if (simplifiedTerm->kind() == ExprKind::Sum){
             for (const Expression* in_term : static_cast<const Sum*>(simplifiedTerm)->get_terms()){
                 openedTerms.push_back(in_term);
             }
         }
-        else if (typeid(*simplifiedTerm) != typeid(Constant)){
+        else{
             openedTerms.push_back(simplifiedTerm);
         }
     }
 
-    for (const Expression* term : openedTerms){
-        const Expression* simplifiedTerm = term->simplify();
+    // Terms of a simplified sum are already simplified
+    for (const Expression* simplifiedTerm : openedTerms){
 
-        if ((typeid(*simplifiedTerm) == typeid(Constant)) && (simplifiedTerm != Constant::e)){
-            constantTerm += static_cast<const Constant*>(simplifiedTerm)->get_exact_value();
+        if (is_exact_constant(simplifiedTerm)){
+            constantTerm += static_cast<const Constant*>(simplifiedTerm)->get_value();
+            continue;
+        }
+
+        // Like terms: c * X + d * X = (c + d) * X
+        std::pair<Rational, const Expression*> split = split_coefficient(simplifiedTerm);
+        auto it = coefficients.find(split.second);
+        if (it == coefficients.end()){
+            coefficients.emplace(split.second, split.first);
+            simplifiedTerms.push_back(split.second);
         }
         else{
-            simplifiedTerms.push_back(simplifiedTerm);
+            it->second += split.first;
         }
     }
 
+    std::sort(simplifiedTerms.begin(), simplifiedTerms.end(), canonical_less);
+
     std::vector<const Expression*> finalTerms;
-    if (constantTerm != 0){
-        finalTerms.push_back(new Constant(constantTerm));
+    if (!constantTerm.is_zero()){
+        finalTerms.push_back(ExpressionFactory::make_constant(constantTerm));
     }
     for (const Expression* term : simplifiedTerms){
-        finalTerms.push_back(term);
+        const Rational& coefficient = coefficients[term];
+        if (coefficient == 1){
+            finalTerms.push_back(term);
+        }
+        else if (!coefficient.is_zero()){
+            finalTerms.push_back(with_coefficient(coefficient, term));
+        }
     }
     if (finalTerms.empty()){
         return Constant::ZERO;
@@ -86,28 +153,31 @@ const Expression* Sum::simplify() const{
         return finalTerms[0];
     }
     else{
-        return new Sum(std::move(finalTerms));
+        // Sums holding the result would fail the same way
+        const Expression* result = ExpressionFactory::make_sum(std::move(finalTerms));
+        result->mark_not_polynomial();
+        return result;
     }
 }
 
-const Expression* Sum::complex_derivative(const std::string& variable) const{
+const Expression* Sum::compute_derivative(const std::string& variable) const{
     std::vector<const Expression*> derivedTerms;
 
     for (const Expression* term : terms_){
         derivedTerms.push_back(term->complex_derivative(variable));
     }
 
-    return (new Sum(std::move(derivedTerms)))->simplify();
+    return ExpressionFactory::make_sum(std::move(derivedTerms))->simplify();
 }
 
-const Expression* Sum::plug_variable(const std::string& variable) const{
+const Expression* Sum::plug_variable(const std::string& variable, const Expression* value) const{
     std::vector<const Expression*> updatedTerms;
 
     for (const Expression* term : terms_){
-        updatedTerms.push_back(term->plug_variable(variable));
+        updatedTerms.push_back(term->plug_variable(variable, value));
     }
 
-    return (new Sum(std::move(updatedTerms)))->simplify();
+    return ExpressionFactory::make_sum(std::move(updatedTerms))->simplify();
 }
 
 
@@ -124,47 +194,81 @@ std::string Sum::to_string() const{
     return s;
 }
 
+bool Sum::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Sum){
+        return false;
+    }
+    const Sum* sum = static_cast<const Sum*>(&other);
+    if (sum->hash() != hash() || sum->terms_.size() != terms_.size()){
+        return false;
+    }
+    for (size_t i = 0; i < terms_.size(); ++i){
+        if (!terms_[i]->equals(*sum->terms_[i])){
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Sum::compute_hash() const{
+    size_t h = string_hash("Sum");
+    for (const Expression* child : terms_){
+        h = combine_hash(h, child->hash());
+    }
+    return h;
+}
+
 
 // Product
 //Product::Product(std::vector<const Expression*>&& factors){
 //    factors_= factors;
 //}
 
-Product::Product(std::vector<const Expression*> factors){
+Product::Product(std::vector<const Expression*> factors) : Expression(ExprKind::Product){
     factors_= factors;
 }
 
-Product::~Product(){
+Product::~Product() = default;
+
+double Product::calculate(const EvalContext& context) const{
+    double result = 1;
     for (const Expression* factor : factors_){
-        delete factor;
+        result *= factor->calculate(context);
     }
+    return result;
 }
 
-const Expression* Product::copy() const{
-    std::vector<const Expression*> clonedFactors;
+Dual Product::calculate_dual(const EvalContext& context, int slot) const{
+    Dual result{1, 0};
     for (const Expression* factor : factors_){
-        clonedFactors.push_back(factor);
+        result = result * factor->calculate_dual(context, slot);
     }
-    return (new Product(std::move(clonedFactors)))->simplify();
+    return result;
 }
 
-double Product::calculate() const{
-    double result = 1;
-    for (const Expression* factor : factors_){
-        result *= factor->calculate();
+Interval Product::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    if (factors_.empty()){
+        return Interval::point(1);
+    }
+    Interval result = factors_[0]->calculate_interval(context, slot, range);
+    for (size_t i = 1; i < factors_.size(); ++i){
+        result = result * factors_[i]->calculate_interval(context, slot, range);
     }
     return result;
 }
 
-const Expression* Product::simplify() const{
+const Expression* Product::compute_simplify() const{
     std::vector<const Expression*> simplifiedFactors;
     std::vector<const Expression*> openedFactors;
     std::vector<const Expression*> fractions;
     std::vector<const Expression*> divisorTerms;
-    std::vector<const Expression*> constantFactor;
-    int constantBuff = 1;
+    Rational constantBuff = 1;
 
-    std::unordered_map<std::string, std::pair<const Expression*, const Expression*>> powers; 
+    std::unordered_map<const Expression*, const Expression*, ExpressionHash, ExpressionEqual> powers;
+    std::vector<const Expression*> bases;
 
     for (const Expression* factor : factors_){
         const Expression* simplifiedFactor = factor->simplify();
@@ -175,31 +279,24 @@ const Expression* Product::simplify() const{
         if (simplifiedFactor == Constant::ONE){
             continue;
         }
-        if ((typeid(*simplifiedFactor) == typeid(Constant)) && (simplifiedFactor != Constant::e)){
-            //std::cout << simplifiedFactor->to_string() << "  :  ";
-            //std::cout << static_cast<const Constant*>(simplifiedFactor)->get_exact_value() << "\n";
-
-            constantBuff *= static_cast<const Constant*>(simplifiedFactor)->get_exact_value();
+        if (is_exact_constant(simplifiedFactor)){
+            constantBuff *= static_cast<const Constant*>(simplifiedFactor)->get_value();
         }
-        else if (typeid(*simplifiedFactor) == typeid(Product)){
-        //std::cout << simplifiedFactor->to_string() << " | ";
-
+        else if (simplifiedFactor->kind() == ExprKind::Product){
             for (const Expression* in_factor : static_cast<const Product*>(simplifiedFactor)->get_factors()){
                 openedFactors.push_back(in_factor);
             }
         }
-        else if (typeid(*simplifiedFactor) != typeid(Constant)){
+        else{
             openedFactors.push_back(simplifiedFactor);
         }
     }
-    //std::cout << "\n";
-    for (const Expression* factor : openedFactors){
-        const Expression* simplifiedFactor = factor->simplify();
-        //std::cout << simplifiedFactor->to_string() << "\n";
-        if (typeid(*simplifiedFactor) == typeid(Constant)){
-            constantBuff *= static_cast<const Constant*>(simplifiedFactor)->get_exact_value();
+    // Factors of a simplified product are already simplified
+    for (const Expression* simplifiedFactor : openedFactors){
+        if (is_exact_constant(simplifiedFactor)){
+            constantBuff *= static_cast<const Constant*>(simplifiedFactor)->get_value();
         }
-        else if (typeid(*simplifiedFactor) == typeid(Fraction)){
+        else if (simplifiedFactor->kind() == ExprKind::Fraction){
             fractions.push_back(simplifiedFactor);
         }
         else{
@@ -213,11 +310,6 @@ const Expression* Product::simplify() const{
         finalFactors.push_back(factor);
     }
 
-    if (!constantFactor.empty()){
-        
-        finalFactors.push_back(new Product(std::move(constantFactor)));
-    }
-
     if (!fractions.empty()){
         for (const Expression* fraction : fractions){
             const Fraction* fraction_ = static_cast<const Fraction*>(fraction);
@@ -226,45 +318,48 @@ const Expression* Product::simplify() const{
         }
     }
 
+    // Powers of the same base: X^a * X^b = X^(a + b)
     for (const Expression* factor : finalFactors){
-        if (typeid(*factor) == typeid(ElementaryFunctions::Power)){
+        const Expression* base = factor;
+        const Expression* power = Constant::ONE;
+        if (factor->kind() == ExprKind::Power){
             const ElementaryFunctions::Power* powExpr = static_cast<const ElementaryFunctions::Power*>(factor);
-            const Expression* base = powExpr->get_base();
-            const Expression* power = powExpr->get_power();
-            std::string key = base->to_string();
-
-            if (powers.find(key) == powers.end()){ 
-                powers[key] = std::make_pair(base, Constant::ZERO);
-            }
+            base = powExpr->get_base();
+            power = powExpr->get_power();
+        }
 
-            powers[key].second = (new operators::Sum({powers[key].second, power}))->simplify();
+        auto it = powers.find(base);
+        if (it == powers.end()){
+            powers.emplace(base, power);
+            bases.push_back(base);
         }
         else{
-            std::string key = factor->to_string();
-            if (powers.find(key) == powers.end()){
-                powers[key] = std::make_pair(factor, Constant::ZERO);
-            }
-            powers[key].second = (new operators::Sum({powers[key].second, Constant::ONE}))->simplify();
+            it->second = ExpressionFactory::make_sum({it->second, power})->simplify();
         }
     }
 
+    std::sort(bases.begin(), bases.end(), canonical_less);
+
     finalFactors.clear();
 
     if (constantBuff != 1){
-        finalFactors.push_back(new Constant(constantBuff));
+        finalFactors.push_back(ExpressionFactory::make_constant(constantBuff));
     }
 
-    for (auto it = powers.begin(); it != powers.end(); ++it){
-        const Expression* base = it->second.first;
-        const Expression* power = it->second.second->simplify();
-        //std::cout << it->first << " : " << base->to_string() << " : " << power->to_string() << "\n";
-        finalFactors.push_back(new ElementaryFunctions::Power(base, power));
+    for (const Expression* base : bases){
+        const Expression* power = powers[base];
+        if (power == Constant::ONE){
+            finalFactors.push_back(base);
+        }
+        else if (power != Constant::ZERO){
+            finalFactors.push_back(ExpressionFactory::make_power(base, power));
+        }
     }
 
     if (!fractions.empty()){
-        const Expression* productDividend = new Product(std::move(finalFactors));
-        const Expression* productDivisor = new Product(std::move(divisorTerms));
-        return new Fraction(productDividend, productDivisor);
+        const Expression* productDividend = ExpressionFactory::make_product(std::move(finalFactors));
+        const Expression* productDivisor = ExpressionFactory::make_product(std::move(divisorTerms));
+        return ExpressionFactory::make_fraction(productDividend, productDivisor);
     }
     else{
         if (finalFactors.empty()){
@@ -274,14 +369,13 @@ const Expression* Product::simplify() const{
             return finalFactors[0];
         }
         else{
-            return new Product(std::move(finalFactors)); 
+            return ExpressionFactory::make_product(std::move(finalFactors)); 
         }
     }
 }
 
-const Expression* Product::complex_derivative(const std::string& variable) const{
+const Expression* Product::compute_derivative(const std::string& variable) const{
     std::vector<const Expression*> derivedFactors;
-    //this->simplify();
     for (long long i = 0; i < factors_.size(); ++i){
 
         std::vector<const Expression*> otherFactors;
@@ -292,21 +386,21 @@ const Expression* Product::complex_derivative(const std::string& variable) const
         }
 
         otherFactors.push_back(factors_[i]->complex_derivative(variable));
-        const Expression* productTerm = new Product(std::move(otherFactors));
+        const Expression* productTerm = ExpressionFactory::make_product(std::move(otherFactors));
         derivedFactors.push_back(productTerm);
     }
 
-    return (new Sum(std::move(derivedFactors)))->simplify();
+    return ExpressionFactory::make_sum(std::move(derivedFactors))->simplify();
 }
 
-const Expression* Product::plug_variable(const std::string& variable) const{
+const Expression* Product::plug_variable(const std::string& variable, const Expression* value) const{
     std::vector<const Expression*> updatedTerms;
 
     for (const Expression* factor : factors_){
-        updatedTerms.push_back(factor->plug_variable(variable));
+        updatedTerms.push_back(factor->plug_variable(variable, value));
     }
 
-    return (new Product(std::move(updatedTerms)))->simplify();
+    return ExpressionFactory::make_product(std::move(updatedTerms))->simplify();
 }
 
 std::string Product::to_string() const{
@@ -321,27 +415,55 @@ std::string Product::to_string() const{
     return s;
 }
 
+bool Product::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Product){
+        return false;
+    }
+    const Product* product = static_cast<const Product*>(&other);
+    if (product->hash() != hash() || product->factors_.size() != factors_.size()){
+        return false;
+    }
+    for (size_t i = 0; i < factors_.size(); ++i){
+        if (!factors_[i]->equals(*product->factors_[i])){
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Product::compute_hash() const{
+    size_t h = string_hash("Product");
+    for (const Expression* child : factors_){
+        h = combine_hash(h, child->hash());
+    }
+    return h;
+}
+
 
 // Fraction
-Fraction::Fraction(const Expression* dividend, const Expression* divisor){
+Fraction::Fraction(const Expression* dividend, const Expression* divisor) : Expression(ExprKind::Fraction){
     dividend_ = dividend;
     divisor_ = divisor;
 }
 
-Fraction::~Fraction(){
-    delete dividend_;
-    delete divisor_;
+Fraction::~Fraction() = default;
+
+double Fraction::calculate(const EvalContext& context) const{
+    return dividend_->calculate(context) / divisor_->calculate(context);
 }
 
-double Fraction::calculate() const{
-    return dividend_->calculate() / divisor_->calculate();
+Dual Fraction::calculate_dual(const EvalContext& context, int slot) const{
+    return dividend_->calculate_dual(context, slot) / divisor_->calculate_dual(context, slot);
 }
 
-const Expression* Fraction::copy() const{
-    return (new Fraction(dividend_, divisor_))->simplify();
+Interval Fraction::calculate_interval(const EvalContext& context, int slot, Interval range) const{
+    return dividend_->calculate_interval(context, slot, range) / divisor_->calculate_interval(context, slot, range);
 }
 
-const Expression* Fraction::simplify() const{
+const Expression* Fraction::compute_simplify() const{
     const Expression* simplifiedDividend = dividend_->simplify();
     const Expression* simplifiedDivisor = divisor_->simplify();
 
@@ -352,44 +474,28 @@ const Expression* Fraction::simplify() const{
         return Constant::ZERO;
     }
 
-    if ((typeid(*simplifiedDividend) == typeid(Constant)) && (simplifiedDividend != Constant::e) && (typeid(*simplifiedDivisor) == typeid(Constant)) && (simplifiedDivisor != Constant::e)){
-
-        int num = static_cast<const Constant*>(simplifiedDividend)->get_exact_value();
-        int den = static_cast<const Constant*>(simplifiedDivisor)->get_exact_value();
-        if ((num < 0) && (den < 0)){
-            num *= -1;
-            den *= -1;
-        }
-        else if (den < 0){
-            num *= -1;
-            den *= -1;
-        }
-
-        if (num % den == 0){
-            return new Constant(num / den);
-        } else{
-            int gcd = std::gcd(abs(num), abs(den));
-            //std::cout << "simplifiedDividend: " << simplifiedDividend->to_string() << std::endl; 
-            //std::cout << "simplifiedDivisor: " << simplifiedDivisor->to_string() << std::endl;
-            return new Fraction(new Constant(num / gcd), new Constant(den / gcd));
-        }
+    // Exact quotients fold into a single rational constant; x/0 is left alone
+    if (is_exact_constant(simplifiedDividend) && is_exact_constant(simplifiedDivisor) && (simplifiedDivisor != Constant::ZERO)){
+        const Rational& num = static_cast<const Constant*>(simplifiedDividend)->get_value();
+        const Rational& den = static_cast<const Constant*>(simplifiedDivisor)->get_value();
+        return ExpressionFactory::make_constant(num / den);
     }
 
-    return new Fraction(simplifiedDividend, simplifiedDivisor);
+    return ExpressionFactory::make_fraction(simplifiedDividend, simplifiedDivisor);
 }
 
-const Expression* Fraction::complex_derivative(const std::string& variable) const{
-    const Expression* numerator = new Sum({
-        new Product({dividend_->complex_derivative(variable), divisor_}),
-        new Product({dividend_, new Product({new Constant(-1), divisor_->complex_derivative(variable)})}),
+const Expression* Fraction::compute_derivative(const std::string& variable) const{
+    const Expression* numerator = ExpressionFactory::make_sum({
+        ExpressionFactory::make_product({dividend_->complex_derivative(variable), divisor_}),
+        ExpressionFactory::make_product({dividend_, ExpressionFactory::make_product({ExpressionFactory::make_constant(-1), divisor_->complex_derivative(variable)})}),
     });
 
-    const Expression* denominator = new Product({divisor_, divisor_});
-    return (new Fraction(numerator, denominator))->simplify();
+    const Expression* denominator = ExpressionFactory::make_product({divisor_, divisor_});
+    return ExpressionFactory::make_fraction(numerator, denominator)->simplify();
 }
 
-const Expression* Fraction::plug_variable(const std::string& variable) const{
-    return (new Fraction(dividend_->plug_variable(variable), divisor_->plug_variable(variable)))->simplify();
+const Expression* Fraction::plug_variable(const std::string& variable, const Expression* value) const{
+    return ExpressionFactory::make_fraction(dividend_->plug_variable(variable, value), divisor_->plug_variable(variable, value))->simplify();
 }
 
 std::string Fraction::to_string() const{
@@ -400,4 +506,19 @@ std::string Fraction::to_string() const{
     s = "(" + dividend_->to_string() + ")" + " / " + "(" + divisor_->to_string() + ")";
     return s;
 }
+
+bool Fraction::equals(const Expression& other) const{
+    if (this == &other){
+        return true;
+    }
+    if (other.kind() != ExprKind::Fraction){
+        return false;
+    }
+    const Fraction* fraction = static_cast<const Fraction*>(&other);
+    return fraction->hash() == hash() && dividend_->equals(*fraction->dividend_) && divisor_->equals(*fraction->divisor_);
+}
+
+size_t Fraction::compute_hash() const{
+    return combine_hash(combine_hash(string_hash("Fraction"), dividend_->hash()), divisor_->hash());
+}
 };
\ No newline at end of file
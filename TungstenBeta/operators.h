@@ -8,17 +8,21 @@ namespace operators{
     private:
         std::vector<const Expression*> terms_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+        const Expression* compute_derivative(const std::string& variable) const override;
+
     public:
         Sum(std::vector<const Expression*>&& terms);
         ~Sum();
-        std::vector<const Expression*> get_terms() const { return terms_; };
+        const std::vector<const Expression*>& get_terms() const { return terms_; };
 
-        double calculate() const override;
-        const Expression* complex_derivative(const std::string& variable) const override;
-        const Expression* copy() const override;
-        const Expression* plug_variable(const std::string& variable) const override;
-        const Expression* simplify() const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
 
@@ -26,19 +30,23 @@ namespace operators{
     private:
         std::vector<const Expression*> factors_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+        const Expression* compute_derivative(const std::string& variable) const override;
+
     public:
         //Product(std::vector<const Expression*>&& factors);
         Product(std::vector<const Expression*> factors);
         ~Product();
 
-        std::vector<const Expression*> get_factors() const { return factors_; };
+        const std::vector<const Expression*>& get_factors() const { return factors_; };
 
-        double calculate() const override;
-        const Expression* simplify() const override;
-        const Expression* plug_variable(const std::string& variable) const override;
-        const Expression* complex_derivative(const std::string& variable) const override;
-        const Expression* copy() const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 
 
@@ -47,19 +55,23 @@ namespace operators{
         const Expression* dividend_;
         const Expression* divisor_;
 
+        size_t compute_hash() const override;
+        const Expression* compute_simplify() const override;
+        const Expression* compute_derivative(const std::string& variable) const override;
+
     public:
         Fraction(const Expression* dividend, const Expression* divisor);
         ~Fraction();
 
-        double calculate() const override;
+        double calculate(const EvalContext& context) const override;
+        Dual calculate_dual(const EvalContext& context, int slot) const override;
+        Interval calculate_interval(const EvalContext& context, int slot, Interval range) const override;
         const Expression* get_dividend() const { return dividend_; };
         const Expression* get_divisor() const { return divisor_; };
 
-        const Expression* simplify() const override;
-        const Expression* plug_variable(const std::string& variable) const override;
-        const Expression* complex_derivative(const std::string& variable) const override;
-        const Expression* copy() const override;
+        const Expression* plug_variable(const std::string& variable, const Expression* value) const override;
         std::string to_string() const override;
+        bool equals(const Expression& other) const override;
     };
 }
 
@@ -0,0 +1,359 @@
+// Benchmarks of the hot paths on generated inputs of increasing size.
+// Inputs come from a fixed seed, so runs are comparable across machines and
+// commits. Results go to stdout as JSON: time and heap allocations per
+// operation, the size of the input and result, and how time grows with the
+// size. A size whose single run takes longer than --max-time ends its series,
+// so a blowup shows up as a high exponent instead of a hang.
+#include "TungstenBeta/TungstenBeta.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+namespace{
+    std::atomic<size_t> allocations{0};
+}
+
+void* operator new(size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size){
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept{
+    std::free(memory);
+}
+
+namespace{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Options{
+        const char* filter = nullptr;
+        // Measuring time per size
+        double min_time = 0.2;
+        // A single run longer than this ends the series
+        double max_time = 1;
+    };
+
+    struct Measurement{
+        std::string name;
+        size_t size;
+        size_t iterations;
+        double ns_per_op;
+        double allocations_per_op;
+        size_t input_nodes;
+        size_t result_nodes;
+        // Nodes interned while the operation ran
+        size_t arena_nodes;
+    };
+
+    std::vector<Measurement> results;
+    // Keeps evaluation results alive
+    volatile double sink;
+
+    size_t count_nodes(const Expression* expr){
+        size_t count = 0;
+        if (expr != nullptr){
+            for_each_node(expr, [&](const Expression*){ ++count; });
+        }
+        return count;
+    }
+
+    size_t count_nodes(const std::string&){
+        return 0;
+    }
+
+    // Runs operation(setup()) in a fresh arena per iteration, so memoized
+    // simplifications and derivatives never carry over; only the operation
+    // is timed. ops is the number of operations one call performs.
+    template <typename Setup, typename Operation>
+    bool measure(const Options& options, const std::string& name, size_t size, size_t ops, Setup setup, Operation operation){
+        Measurement measurement{name, size, 0, 0, 0, 0, 0, 0};
+        double total = 0;
+        size_t allocated = 0;
+        bool warm = false;
+        while (true){
+            ExpressionArena arena;
+            ExpressionArena::Scope scope(arena);
+            auto input = setup();
+            size_t before = allocations.load();
+            auto start = Clock::now();
+            const Expression* result = operation(input);
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            size_t count = allocations.load() - before;
+
+            if (!warm){
+                measurement.input_nodes = count_nodes(input);
+                measurement.result_nodes = count_nodes(result);
+                measurement.arena_nodes = arena.node_count();
+                warm = true;
+                // Too slow to repeat: the warm-up run is the measurement
+                if (elapsed > options.max_time){
+                    total = elapsed;
+                    allocated = count;
+                    measurement.iterations = 1;
+                    break;
+                }
+                continue;
+            }
+            total += elapsed;
+            allocated += count;
+            ++measurement.iterations;
+            if (total >= options.min_time && measurement.iterations >= 3){
+                break;
+            }
+        }
+        double operations = static_cast<double>(measurement.iterations * ops);
+        measurement.ns_per_op = total * 1e9 / operations;
+        measurement.allocations_per_op = allocated / operations;
+        results.push_back(measurement);
+        return total / measurement.iterations <= options.max_time;
+    }
+
+    // Runs one benchmark for every size until a run gets too slow
+    template <typename Benchmark>
+    void series(const Options& options, const std::string& name, const std::vector<size_t>& sizes, Benchmark benchmark){
+        if (options.filter != nullptr && name.find(options.filter) == std::string::npos){
+            return;
+        }
+        for (size_t size : sizes){
+            if (!benchmark(size)){
+                break;
+            }
+        }
+    }
+
+    std::vector<size_t> sizes(size_t first, size_t last, size_t factor){
+        std::vector<size_t> result;
+        for (size_t size = first; size <= last; size *= factor){
+            result.push_back(size);
+        }
+        return result;
+    }
+
+    // Deterministic input text: count terms mixing every function the parser knows
+    std::string random_text(size_t count, uint32_t seed){
+        std::mt19937 random(seed);
+        std::string text;
+        for (size_t i = 0; i < count; ++i){
+            std::string k = std::to_string(random() % 9 + 1);
+            std::string c = std::to_string(random() % 5 + 1);
+            if (i != 0){
+                text += random() % 2 ? " + " : " - ";
+            }
+            switch (random() % 6){
+                case 0: text += k + "*x^" + c; break;
+                case 1: text += "sin(" + k + "*x + " + c + ")"; break;
+                case 2: text += "ln(x + " + k + ")/(x^2 + " + c + ")"; break;
+                case 3: text += "e^(x/" + k + ")"; break;
+                case 4: text += "sqrt(x + " + k + ")cos(x)"; break;
+                default: text += "(x + " + k + ")(x - " + c + ")"; break;
+            }
+        }
+        return text;
+    }
+
+    // count terms with many like terms, for the combining done by simplify()
+    std::string wide_sum(size_t count){
+        std::string text;
+        for (size_t i = 0; i < count; ++i){
+            if (i != 0){
+                text += " + ";
+            }
+            std::string k = std::to_string(i % 11 + 1);
+            switch (i % 4){
+                case 0: text += k + "*x^" + std::to_string(i % 7); break;
+                case 1: text += k + "*sin(x)"; break;
+                case 2: text += k; break;
+                default: text += "x*y^" + std::to_string(i % 3 + 1); break;
+            }
+        }
+        return text;
+    }
+
+    std::string wide_product(size_t count){
+        std::string text;
+        for (size_t i = 0; i < count; ++i){
+            if (i != 0){
+                text += " * ";
+            }
+            switch (i % 4){
+                case 0: text += "x^" + std::to_string(i % 5 + 1); break;
+                case 1: text += std::to_string(i % 7 + 2); break;
+                case 2: text += "cos(x)"; break;
+                default: text += "(x + " + std::to_string(i % 3 + 1) + ")"; break;
+            }
+        }
+        return text;
+    }
+
+    // ((x + 1)(x + 1) + 2)(x + 2) ... : every level multiplies the last one
+    const Expression* nested_product(size_t depth){
+        const Expression* x = ExpressionFactory::make_variable("x");
+        const Expression* result = x;
+        for (size_t i = 1; i <= depth; ++i){
+            const Expression* k = ExpressionFactory::make_constant(static_cast<long long>(i));
+            result = ExpressionFactory::make_product({
+                ExpressionFactory::make_sum({result, k}),
+                ExpressionFactory::make_sum({x, k})});
+        }
+        return result;
+    }
+
+    // sin(cos(e^(ln(...(x))))) with depth calls
+    const Expression* composition(size_t depth){
+        const Expression* result = ExpressionFactory::make_variable("x");
+        for (size_t i = 0; i < depth; ++i){
+            switch (i % 4){
+                case 0: result = ExpressionFactory::make_sin(result); break;
+                case 1: result = ExpressionFactory::make_cos(result); break;
+                case 2: result = ExpressionFactory::make_exp(Constant::e, result); break;
+                default: result = ExpressionFactory::make_log(Constant::e, result); break;
+            }
+        }
+        return result;
+    }
+
+    // x + x^2/2 + ... + x^n/n - 2: increasing and convex for x > 0, with a
+    // root near 1 - e^-2 for large n. Started from 0.9, right of the root
+    // once n >= 16, Newton converges monotonically at every size; from the
+    // left it overshoots to where x^n explodes.
+    std::string log_series(size_t count){
+        std::string text;
+        for (size_t k = 1; k <= count; ++k){
+            text += "x^" + std::to_string(k) + "/" + std::to_string(k) + " + ";
+        }
+        return text + "-2";
+    }
+
+    void run_benchmarks(const Options& options){
+        auto parsed = [](const std::string& text){
+            return [text](){ return Parser::parse(text); };
+        };
+
+        series(options, "parse", sizes(16, 16384, 4), [&](size_t size){
+            std::string text = random_text(size, 1);
+            return measure(options, "parse", size, 1, [&](){ return text; },
+                           [](const std::string& input){ return Parser::parse(input); });
+        });
+        series(options, "simplify_wide_sum", sizes(16, 4096, 4), [&](size_t size){
+            return measure(options, "simplify_wide_sum", size, 1, parsed(wide_sum(size)),
+                           [](const Expression* input){ return input->simplify(); });
+        });
+        series(options, "simplify_wide_product", sizes(16, 4096, 4), [&](size_t size){
+            return measure(options, "simplify_wide_product", size, 1, parsed(wide_product(size)),
+                           [](const Expression* input){ return input->simplify(); });
+        });
+        series(options, "derivative_nested_product", sizes(4, 1024, 4), [&](size_t size){
+            return measure(options, "derivative_nested_product", size, 1, [size](){ return nested_product(size); },
+                           [](const Expression* input){ return input->complex_derivative("x"); });
+        });
+        series(options, "derivative_composition", sizes(4, 1024, 4), [&](size_t size){
+            return measure(options, "derivative_composition", size, 1, [size](){ return composition(size); },
+                           [](const Expression* input){ return input->complex_derivative("x"); });
+        });
+        series(options, "calculate", sizes(16, 16384, 4), [&](size_t size){
+            // One operation is one evaluation; a call sweeps POINTS of them
+            const size_t POINTS = 1024;
+            return measure(options, "calculate", size, POINTS, parsed(random_text(size, 2)),
+                           [](const Expression* input) -> const Expression*{
+                EvalContext context;
+                int slot = EvalContext::slot_of("x");
+                double sum = 0;
+                for (size_t i = 0; i < POINTS; ++i){
+                    context.set(slot, 0.1 + 1.9 * i / POINTS);
+                    sum += input->calculate(context);
+                }
+                sink = sum;
+                return nullptr;
+            });
+        });
+        series(options, "taylor_series", sizes(2, 64, 2), [&](size_t size){
+            return measure(options, "taylor_series", size, 1, parsed("e^(sin(x))/(1 + x^2)"),
+                           [size](const Expression* input){ return Taylor_series(input, "x", 0.5, size); });
+        });
+        series(options, "newton_root", sizes(4, 1024, 4), [&](size_t size){
+            return measure(options, "newton_root", size, 1, parsed(log_series(size)),
+                           [](const Expression* input){ return NewtonMethod::Newton_root(input, "x", 0.9); });
+        });
+    }
+
+    void print_json(const Options& options){
+#ifdef __OPTIMIZE__
+        const bool optimized = true;
+#else
+        const bool optimized = false;
+#endif
+        std::printf("{\n  \"build_type\": \"%s\",\n  \"optimized\": %s,\n", TUNGSTEN_BUILD_TYPE, optimized ? "true" : "false");
+        std::printf("  \"min_time\": %g,\n  \"max_time\": %g,\n  \"benchmarks\": [", options.min_time, options.max_time);
+        for (size_t i = 0; i < results.size(); ++i){
+            const Measurement& m = results[i];
+            std::printf("%s\n    {\"name\": \"%s\", \"size\": %zu, \"iterations\": %zu, \"ns_per_op\": %.1f, "
+                        "\"allocations_per_op\": %.1f, \"input_nodes\": %zu, \"result_nodes\": %zu, \"arena_nodes\": %zu",
+                        i == 0 ? "" : ",", m.name.c_str(), m.size, m.iterations, m.ns_per_op,
+                        m.allocations_per_op, m.input_nodes, m.result_nodes, m.arena_nodes);
+            // Time ~ size^exponent between this size and the previous one:
+            // about 1 for linear work, 2 for quadratic
+            if (i != 0 && results[i - 1].name == m.name){
+                const Measurement& previous = results[i - 1];
+                double exponent = std::log(m.ns_per_op / previous.ns_per_op) / std::log(double(m.size) / previous.size);
+                std::printf(", \"exponent\": %.2f", exponent);
+            }
+            std::printf("}");
+        }
+        std::printf("\n  ]\n}\n");
+    }
+
+    bool read_seconds(const char* text, double& value){
+        char* end = nullptr;
+        value = std::strtod(text, &end);
+        return *text != '\0' && *end == '\0' && value > 0;
+    }
+}
+
+int main(int argc, char *argv[]){
+    Options options;
+    for (int i = 1; i < argc; ++i){
+        bool valid = i + 1 < argc;
+        if (valid && std::strcmp(argv[i], "--filter") == 0){
+            options.filter = argv[++i];
+        }
+        else if (valid && std::strcmp(argv[i], "--min-time") == 0){
+            valid = read_seconds(argv[++i], options.min_time);
+        }
+        else if (valid && std::strcmp(argv[i], "--max-time") == 0){
+            valid = read_seconds(argv[++i], options.max_time);
+        }
+        else{
+            valid = false;
+        }
+        if (!valid){
+            std::fputs("usage: tungsten_bench [--filter TEXT] [--min-time SECONDS] [--max-time SECONDS]\n", stderr);
+            return 2;
+        }
+    }
+    run_benchmarks(options);
+    print_json(options);
+    return 0;
+}
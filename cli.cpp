@@ -0,0 +1,5 @@
+#include "TungstenBeta/TungstenBetaCLI.h"
+
+int main(int argc, char *argv[]) {
+    return run_cli(argc, argv);
+}